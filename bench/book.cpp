@@ -0,0 +1,493 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "harness.hpp"
+#include "level.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <span>
+#include <utility>
+
+namespace {
+    using namespace bench;
+    using market::side;
+
+    // Random inputs are pre-generated outside of the timed loop and accessed modulo their size
+    constexpr std::size_t inputs = 1024;
+    constexpr std::size_t mask = inputs - 1;
+
+    // Prices of both hits and misses, including prices outside of the book on both ends
+    template <int Size>
+    std::vector<int> queries() {
+        return random(inputs, price<side::bid>(Size) - 1, price<side::bid>(0) + 2);
+    }
+
+    // Cost of filling the book, including amortized reset() once both sides are full
+    struct push_back {
+        template <int Size, typename Policy, typename Index>
+        static std::uint64_t run(state& s) {
+            fixed_book<Size, Policy, Index> book;
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                book.reset();
+                for (int i = 0; i < Size; ++i) {
+                    keep(book.template push_back<side::bid>(level{price<side::bid>(i), i}));
+                    keep(book.template push_back<side::ask>(level{price<side::ask>(i), i}));
+                }
+            }
+            s.stop();
+            return s.iterations * Size * 2;
+        }
+    };
+
+    struct emplace_back {
+        template <int Size, typename Policy, typename Index>
+        static std::uint64_t run(state& s) {
+            fixed_book<Size, Policy, Index> book;
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                book.reset();
+                for (int i = 0; i < Size; ++i) {
+                    keep(book.template emplace_back<side::bid>(price<side::bid>(i), i));
+                    keep(book.template emplace_back<side::ask>(price<side::ask>(i), i));
+                }
+            }
+            s.stop();
+            return s.iterations * Size * 2;
+        }
+    };
+
+    // Remove at random position, followed by push_back() of the same level to maintain the depth
+    struct remove {
+        template <int Size, typename Policy, typename Index>
+        static std::uint64_t run(state& s) {
+            fixed_book<Size, Policy, Index> book;
+            fill(book);
+            const auto pos = random(inputs, 0, Size - 1);
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                const auto i = (Index)pos[n & mask];
+                const level l = book.template at<side::bid>(i);
+                book.template remove<side::bid>(i);
+                keep(book.template push_back<side::bid>(l));
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    // Remove at random position, followed by insert() of the same level to maintain the depth
+    struct insert {
+        template <int Size, typename Policy, typename Index>
+        static std::uint64_t run(state& s) {
+            fixed_book<Size, Policy, Index> book;
+            fill(book);
+            const auto pos = random(inputs, 0, Size - 1);
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                const auto i = (Index)pos[n & mask];
+                const level l = book.template at<side::bid>(i);
+                book.template remove<side::bid>(i);
+                keep(book.template insert<side::bid>(l));
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    // Single level at random position changes price, followed by sort()
+    struct sort {
+        template <int Size, typename Policy, typename Index>
+        static std::uint64_t run(state& s) {
+            fixed_book<Size, Policy, Index> book;
+            fill(book);
+            const auto pos = random(inputs, 0, Size - 1);
+            const auto prices = random(inputs, price<side::bid>(Size - 1), price<side::bid>(0));
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                book.template at<side::bid>((Index)pos[n & mask]).ticks = prices[n & mask];
+                book.template sort<side::bid>();
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    // As sort, but using resort_one() on the level which changed price
+    struct resort_one {
+        template <int Size, typename Policy, typename Index>
+        static std::uint64_t run(state& s) {
+            fixed_book<Size, Policy, Index> book;
+            fill(book);
+            const auto pos = random(inputs, 0, Size - 1);
+            const auto prices = random(inputs, price<side::bid>(Size - 1), price<side::bid>(0));
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                book.template at<side::bid>((Index)pos[n & mask]).ticks = prices[n & mask];
+                book.template resort_one<side::bid>((Index)pos[n & mask]);
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    struct binary_search {
+        template <int Size, typename Policy, typename Index>
+        static std::uint64_t run(state& s) {
+            fixed_book<Size, Policy, Index> book;
+            fill(book);
+            const auto q = queries<Size>();
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                keep(book.template binary_search<side::bid>(q[n & mask]));
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    struct lower_bound {
+        template <int Size, typename Policy, typename Index>
+        static std::uint64_t run(state& s) {
+            fixed_book<Size, Policy, Index> book;
+            fill(book);
+            const auto q = queries<Size>();
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                keep(book.template lower_bound<side::bid>(q[n & mask]));
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    struct upper_bound {
+        template <int Size, typename Policy, typename Index>
+        static std::uint64_t run(state& s) {
+            fixed_book<Size, Policy, Index> book;
+            fill(book);
+            const auto q = queries<Size>();
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                keep(book.template upper_bound<side::bid>(q[n & mask]));
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    struct equal_range {
+        template <int Size, typename Policy, typename Index>
+        static std::uint64_t run(state& s) {
+            fixed_book<Size, Policy, Index> book;
+            fill(book);
+            const auto q = queries<Size>();
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                keep(book.template equal_range<side::bid>(q[n & mask]));
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    // Top of book update: best level replaced with a new one, alternating between two prices
+    struct churn_top {
+        template <int Size, typename Policy, typename Index>
+        static std::uint64_t run(state& s) {
+            fixed_book<Size, Policy, Index> book;
+            fill(book);
+            const int top = price<side::bid>(0);
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                book.template remove<side::bid>(0);
+                keep(book.template push_back<side::bid>(level{top + (int)(n & 1), (int)n}));
+                book.template sort<side::bid>();
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    // As churn_top, but using insert() rather than push_back() followed by sort()
+    struct churn_top_insert {
+        template <int Size, typename Policy, typename Index>
+        static std::uint64_t run(state& s) {
+            fixed_book<Size, Policy, Index> book;
+            fill(book);
+            const int top = price<side::bid>(0);
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                book.template remove<side::bid>(0);
+                keep(book.template insert<side::bid>(level{top + (int)(n & 1), (int)n}));
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    // Deep cancel: level in the bottom half of the book removed and replaced with a new size
+    struct churn_deep {
+        template <int Size, typename Policy, typename Index>
+        static std::uint64_t run(state& s) {
+            fixed_book<Size, Policy, Index> book;
+            fill(book);
+            const auto pos = random(inputs, Size / 2, Size - 1);
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                const auto i = (Index)pos[n & mask];
+                const level l = book.template at<side::bid>(i);
+                book.template remove<side::bid>(i);
+                keep(book.template push_back<side::bid>(level{l.ticks, (int)n}));
+                book.template sort<side::bid>();
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    // As churn_deep, but using insert() rather than push_back() followed by sort()
+    struct churn_deep_insert {
+        template <int Size, typename Policy, typename Index>
+        static std::uint64_t run(state& s) {
+            fixed_book<Size, Policy, Index> book;
+            fill(book);
+            const auto pos = random(inputs, Size / 2, Size - 1);
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                const auto i = (Index)pos[n & mask];
+                const level l = book.template at<side::bid>(i);
+                book.template remove<side::bid>(i);
+                keep(book.template insert<side::bid>(level{l.ticks, (int)n}));
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    // Full refresh of both sides, levels arriving in random order, reported per refresh
+    struct churn_refresh {
+        template <int Size, typename Policy, typename Index>
+        static std::uint64_t run(state& s) {
+            fixed_book<Size, Policy, Index> book;
+            std::vector<int> order(Size);
+            std::iota(order.begin(), order.end(), 0);
+            std::shuffle(order.begin(), order.end(), std::mt19937{42});
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                book.reset();
+                for (const int i : order) {
+                    book.template push_back<side::bid>(level{price<side::bid>(i), i});
+                    book.template push_back<side::ask>(level{price<side::ask>(i), i});
+                }
+                book.template sort<side::bid>();
+                book.template sort<side::ask>();
+                keep(book.template at<side::bid>(0));
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    // Total size of all levels on a side, with one level changed between passes. Index loop over at()
+    // compared with std::accumulate over iterators
+    template <bool Iterators>
+    struct accumulate {
+        template <int Size, typename Policy, typename Index>
+        static std::uint64_t run(state& s) {
+            fixed_book<Size, Policy, Index> book;
+            fill(book);
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                const auto i = (Index)(n % Size);
+                book.template at<side::bid>(i) = level{price<side::bid>(i), (int)n};
+                int total = 0;
+                if constexpr (Iterators) {
+                    total = std::accumulate(book.template begin<side::bid>(), book.template end<side::bid>(), 0,
+                            [](int t, const level& l) { return t + l.size; });
+                } else {
+                    for (Index i = 0; i < book.template size<side::bid>(); ++i) {
+                        total += book.template at<side::bid>(i).size;
+                    }
+                }
+                keep(total);
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    // Price reached and notional of a sweep of random quantity, up to the quantity of the whole side.
+    // With cumulative totals, or by adding quantities of levels from the top
+    template <bool Totals>
+    struct sweep {
+        template <int Size, typename Policy, typename Index>
+        static std::uint64_t run(state& s) {
+            fixed_book<Size, Policy, Index> book;
+            fill(book);
+            int all = 0;
+            for (int i = 0; i < Size; ++i) {
+                all += book.template at<side::bid>((Index)i).size;
+            }
+            const auto q = random(inputs, 1, all);
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                const std::int64_t quantity = q[n & mask];
+                if constexpr (Totals) {
+                    const auto f = book.template sweep<side::bid>(quantity);
+                    keep(f.notional);
+                } else {
+                    std::int64_t left = quantity, notional = 0;
+                    for (Index i = 0; i < book.template size<side::bid>() && left > 0; ++i) {
+                        const auto& l = book.template at<side::bid>(i);
+                        const auto take = std::min<std::int64_t>(left, l.size);
+                        left -= take;
+                        notional += take * l.ticks;
+                    }
+                    keep(notional);
+                }
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    struct packet_op {
+        market::action what;
+        bench::level level;
+    };
+
+    // Packet of 16 updates, each replacing one of 8 levels spread across the side, reported per
+    // packet. Applied with apply_batch(), or one by one with find(), remove() and insert()
+    template <bool Batch>
+    struct churn_packet {
+        template <int Size, typename Policy, typename Index>
+        static std::uint64_t run(state& s) {
+            using book_type = fixed_book<Size, Policy, Index>;
+            constexpr int k = Size < 8 ? Size : 8;
+            book_type book;
+            fill(book);
+            const auto start = random(inputs, 0, Size - 1);
+            packet_op ops[k * 2] = {};
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                const int r = start[n & mask];
+                for (int j = 0; j < k; ++j) {
+                    const int p = price<side::bid>((r + j * (Size / k)) % Size);
+                    ops[j * 2] = packet_op{market::action::erase, level{p, 0}};
+                    ops[j * 2 + 1] = packet_op{market::action::insert, level{p, (int)n}};
+                }
+                if constexpr (Batch) {
+                    keep(book.template apply_batch<side::bid>(std::span<packet_op>(ops)));
+                } else {
+                    for (const auto& o : ops) {
+                        if (o.what == market::action::insert) {
+                            keep(book.template insert<side::bid>(o.level));
+                        } else {
+                            const auto i = book.template find<side::bid>(o.level);
+                            if (i != book_type::npos) {
+                                book.template remove<side::bid>(i);
+                            }
+                        }
+                    }
+                }
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    // Register Workload for each of the depths I
+    template <typename Workload, typename Policy = level, typename Index = std::uint8_t, int ... I>
+    bool add(const char* name, std::integer_sequence<int, I...>) {
+        (registrar{name, I, &Workload::template run<I, Policy, Index>}, ...);
+        return true;
+    }
+
+    template <int ... I>
+    constexpr auto plus_one(std::integer_sequence<int, I...>) {
+        return std::integer_sequence<int, (I + 1)...>{};
+    }
+
+    // All sizes supported by book::data, and a selection of depths for less important variants
+    using depths = decltype(plus_one(std::make_integer_sequence<int, 127>{}));
+    using selected = std::integer_sequence<int, 1, 2, 3, 4, 5, 6, 8, 10, 12, 16, 20, 24, 32, 48, 64, 96, 127>;
+    // Depths only supported with 16 bit index, as well as some of the above for comparison
+    using deep = std::integer_sequence<int, 5, 10, 20, 64, 127, 256, 512, 1000, 2000>;
+    // Depths of typical fixed depth feeds, compared between static_book and book
+    using feeds = std::integer_sequence<int, 5, 10, 20>;
+
+    const bool registered = add<push_back>("book/push_back", depths{})
+            && add<emplace_back>("book/emplace_back", depths{})
+            && add<remove>("book/remove", depths{})
+            && add<insert>("book/insert", depths{})
+            && add<sort>("book/sort", depths{})
+            && add<resort_one>("book/resort_one", depths{})
+            && add<binary_search>("book/binary_search", depths{})
+            && add<lower_bound>("book/lower_bound", depths{})
+            && add<upper_bound>("book/upper_bound", depths{})
+            && add<equal_range>("book/equal_range", depths{})
+            && add<churn_top>("book/churn/top", depths{})
+            && add<churn_top_insert>("book/churn/top/insert", depths{})
+            && add<churn_deep>("book/churn/deep", depths{})
+            && add<churn_deep_insert>("book/churn/deep/insert", depths{})
+            && add<churn_refresh>("book/churn/refresh", depths{})
+            && add<accumulate<false>>("book/accumulate/at", selected{})
+            && add<accumulate<true>>("book/accumulate/iterator", selected{})
+            && add<churn_packet<true>>("book/churn/packet/batch", selected{})
+            && add<churn_packet<false>>("book/churn/packet/each", selected{})
+            && add<insert, linear>("book/linear/insert", selected{})
+            && add<binary_search, linear>("book/linear/binary_search", selected{})
+            && add<lower_bound, linear>("book/linear/lower_bound", selected{})
+            && add<upper_bound, linear>("book/linear/upper_bound", selected{})
+            && add<equal_range, linear>("book/linear/equal_range", selected{})
+            && add<churn_top_insert, linear>("book/linear/churn/top/insert", selected{})
+            && add<churn_deep_insert, linear>("book/linear/churn/deep/insert", selected{})
+            && add<push_back, level, std::uint16_t>("book/wide/push_back", deep{})
+            && add<remove, level, std::uint16_t>("book/wide/remove", deep{})
+            && add<insert, level, std::uint16_t>("book/wide/insert", deep{})
+            && add<sort, level, std::uint16_t>("book/wide/sort", deep{})
+            && add<resort_one, level, std::uint16_t>("book/wide/resort_one", deep{})
+            && add<binary_search, level, std::uint16_t>("book/wide/binary_search", deep{})
+            && add<lower_bound, level, std::uint16_t>("book/wide/lower_bound", deep{})
+            && add<churn_top_insert, level, std::uint16_t>("book/wide/churn/top/insert", deep{})
+            && add<churn_deep_insert, level, std::uint16_t>("book/wide/churn/deep/insert", deep{})
+            && add<churn_refresh, level, std::uint16_t>("book/wide/churn/refresh", deep{})
+            && add<accumulate<false>, level, std::uint16_t>("book/wide/accumulate/at", deep{})
+            && add<accumulate<true>, level, std::uint16_t>("book/wide/accumulate/iterator", deep{})
+            && add<churn_packet<true>, level, std::uint16_t>("book/wide/churn/packet/batch", deep{})
+            && add<churn_packet<false>, level, std::uint16_t>("book/wide/churn/packet/each", deep{})
+            && add<push_back, fixed<level>>("book/static/push_back", feeds{})
+            && add<remove, fixed<level>>("book/static/remove", feeds{})
+            && add<insert, fixed<level>>("book/static/insert", feeds{})
+            && add<resort_one, fixed<level>>("book/static/resort_one", feeds{})
+            && add<binary_search, fixed<level>>("book/static/binary_search", feeds{})
+            && add<lower_bound, fixed<level>>("book/static/lower_bound", feeds{})
+            && add<churn_top_insert, fixed<level>>("book/static/churn/top/insert", feeds{})
+            && add<churn_deep_insert, fixed<level>>("book/static/churn/deep/insert", feeds{})
+            && add<churn_packet<true>, fixed<level>>("book/static/churn/packet/batch", feeds{})
+            && add<insert, fixed<linear>>("book/static/linear/insert", feeds{})
+            && add<churn_deep_insert, fixed<linear>>("book/static/linear/churn/deep/insert", feeds{})
+            && add<insert, columns>("book/columns/insert", selected{})
+            && add<binary_search, columns>("book/columns/binary_search", selected{})
+            && add<lower_bound, columns>("book/columns/lower_bound", selected{})
+            && add<churn_deep_insert, columns>("book/columns/churn/deep/insert", selected{})
+            && add<accumulate<true>, columns>("book/columns/accumulate/iterator", selected{})
+            && add<binary_search, columns, std::uint16_t>("book/wide/columns/binary_search", deep{})
+            && add<accumulate<true>, columns, std::uint16_t>("book/wide/columns/accumulate/iterator", deep{})
+            && add<insert, counted>("book/counted/insert", selected{})
+            && add<binary_search, counted>("book/counted/binary_search", selected{})
+            && add<churn_deep_insert, counted>("book/counted/churn/deep/insert", selected{})
+            && add<sweep<false>>("book/sweep/loop", selected{})
+            && add<sweep<true>, totals>("book/sweep/totals", selected{})
+            && add<insert, totals>("book/cumulative/insert", selected{})
+            && add<churn_top_insert, totals>("book/cumulative/churn/top/insert", selected{})
+            && add<churn_deep_insert, totals>("book/cumulative/churn/deep/insert", selected{})
+            && add<sweep<false>, level, std::uint16_t>("book/wide/sweep/loop", deep{})
+            && add<sweep<true>, totals, std::uint16_t>("book/wide/sweep/totals", deep{})
+            && add<lower_bound, linear, std::uint16_t>("book/wide/linear/lower_bound", deep{})
+            && add<insert, linear, std::uint16_t>("book/wide/linear/insert", deep{});
+}
@@ -0,0 +1,100 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "harness.hpp"
+#include "level.hpp"
+
+#include "market/consolidated.hpp"
+
+#include <algorithm>
+#include <array>
+#include <utility>
+#include <vector>
+
+namespace {
+    using namespace bench;
+    using market::side;
+
+    // Number of venues, and of consolidated levels read after every change
+    constexpr std::size_t venues = 8;
+    constexpr std::size_t top = 5;
+
+    // Top level of one venue at a time is replaced, then the top consolidated levels are read. Venue
+    // books are filled with the same prices, so all levels are aggregated across all venues. Mode
+    // "best" only reads the best top level, which does not need the lazy merge.
+    enum class mode { best, refresh, rebuild, materialize };
+
+    template <mode Mode>
+    struct tick {
+        template <int Size>
+        static std::uint64_t run(state& s) {
+            using book_type = fixed_book<Size>;
+            using view_type = market::consolidated<typename book_type::book, venues>;
+            std::array<book_type, venues> books;
+            std::array<const typename book_type::book*, venues> pointers = {};
+            for (std::size_t v = 0; v < venues; ++v) {
+                fill(books[v]);
+                pointers[v] = &books[v];
+            }
+            view_type view(pointers);
+            std::vector<level> all;
+            all.reserve(Size * venues);
+            const int best = price<side::bid>(0);
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                auto& b = books[n % venues];
+                b.template remove<side::bid>(0);
+                keep(b.template insert<side::bid>(level{best + (int)((n / venues) & 1), (int)n}));
+                int total = 0;
+                if constexpr (Mode == mode::materialize) {
+                    // Combined book, built from all levels of all venues
+                    all.clear();
+                    for (const auto& v : books) {
+                        for (int i = 0; i < (int)v.template size<side::bid>(); ++i) {
+                            all.push_back(v.template at<side::bid>(i));
+                        }
+                    }
+                    std::sort(all.begin(), all.end(), [](const level& lh, const level& rh) {
+                        return level::compare<side::bid>(lh, rh);
+                    });
+                    for (std::size_t i = 0, k = 0; i < all.size() && k < top; ++k) {
+                        const int t = all[i].ticks;
+                        for (; i < all.size() && all[i].ticks == t; ++i) {
+                            total += all[i].size;
+                        }
+                    }
+                } else if constexpr (Mode == mode::best) {
+                    view.refresh();
+                    total = view.template top<side::bid>()->size;
+                } else {
+                    if constexpr (Mode == mode::rebuild) {
+                        view = view_type(pointers);
+                    } else {
+                        view.refresh();
+                    }
+                    view.template for_each<side::bid>(top, [&total](const level& l, std::uint64_t) {
+                        total += l.size;
+                    });
+                }
+                keep(total);
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    template <typename Workload, int ... I>
+    bool add(const char* name, std::integer_sequence<int, I...>) {
+        (registrar{name, I, &Workload::template run<I>}, ...);
+        return true;
+    }
+
+    using depths = std::integer_sequence<int, 5, 10, 20, 64>;
+
+    const bool registered = add<tick<mode::best>>("consolidated/best", depths{})
+            && add<tick<mode::refresh>>("consolidated/refresh", depths{})
+            && add<tick<mode::rebuild>>("consolidated/rebuild", depths{})
+            && add<tick<mode::materialize>>("consolidated/materialize", depths{});
+}
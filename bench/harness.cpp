@@ -0,0 +1,134 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "harness.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+
+namespace bench {
+    std::vector<benchmark>& registry() {
+        static std::vector<benchmark> instance;
+        return instance;
+    }
+
+    double result::per_op(perf::event e) const {
+        return counts.available(e) && ops != 0 ? counts[e] / (double)ops : NAN;
+    }
+
+    double result::ipc() const {
+        using enum perf::event;
+        return counts.available(instructions) && counts.available(cycles) && counts[cycles] > 0.0
+                ? counts[instructions] / counts[cycles]
+                : NAN;
+    }
+
+    result measure(const benchmark& b, const options& o, perf* p) {
+        // Calibrate the number of iterations, so that a single measurement takes at least min_time
+        std::uint64_t n = 1;
+        for (;;) {
+            state s{n};
+            b.fn(s);
+            const auto elapsed = s.elapsed();
+            if (elapsed >= o.min_time / 10 || n >= (1ull << 40)) {
+                const auto estimate = (double)n * o.min_time / std::max(elapsed, 1.0);
+                n = std::max<std::uint64_t>(n, (std::uint64_t)estimate);
+                break;
+            }
+            n *= 10;
+        }
+
+        // Report the fastest of the measurements, which is the least affected by noise
+        result best{b.name, b.depth, 0, 0.0};
+        for (int i = 0; i < std::max(o.repeat, 1); ++i) {
+            state s{n, p};
+            const auto ops = b.fn(s);
+            const result r{b.name, b.depth, ops, s.elapsed(), s.counts()};
+            if (best.ops == 0 || r.ns_per_op() < best.ns_per_op()) {
+                best = r;
+            }
+        }
+        return best;
+    }
+
+    namespace {
+        // Hardware counters reported per operation, with their column names
+        constexpr perf::event events[] = {perf::event::l1d_misses, perf::event::llc_misses,
+                                          perf::event::branch_misses};
+        constexpr const char* columns[] = {"l1d_miss/op", "llc_miss/op", "br_miss/op"};
+
+        void print_counters(const result& r, bool csv) {
+            const auto print = [csv](double v) {
+                if (csv) {
+                    std::isnan(v) ? std::printf(",") : std::printf(",%.4f", v);
+                } else {
+                    std::isnan(v) ? std::printf(" %12s", "-") : std::printf(" %12.4f", v);
+                }
+            };
+            print(r.ipc());
+            for (const auto e : events) {
+                print(r.per_op(e));
+            }
+        }
+    }
+
+    int run(const options& o) {
+        std::unique_ptr<perf> p;
+        if (o.counters) {
+            p = std::make_unique<perf>();
+            if (not p->any()) {
+                std::fprintf(stderr, "hardware counters not available: %s\n", p->error().c_str());
+                p.reset();
+            }
+        }
+
+        if (o.csv) {
+            std::printf("name,depth,ops,ns,ns_per_op,ops_per_sec");
+            if (o.counters) {
+                std::printf(",ipc,%s,%s,%s", columns[0], columns[1], columns[2]);
+            }
+            std::printf("\n");
+        } else {
+            std::printf("%-32s %6s %12s %16s", "name", "depth", "ns/op", "ops/sec");
+            if (o.counters) {
+                std::printf(" %12s %12s %12s %12s", "ipc", columns[0], columns[1], columns[2]);
+            }
+            std::printf("\n");
+        }
+
+        int count = 0;
+        for (const auto& b : registry()) {
+            if (b.depth < o.depth_min || b.depth > o.depth_max) {
+                continue;
+            }
+            if (not o.filter.empty() && b.name.find(o.filter) == std::string::npos) {
+                continue;
+            }
+
+            const auto r = measure(b, o, p.get());
+            if (o.csv) {
+                std::printf("%s,%d,%llu,%.0f,%.3f,%.0f", r.name.c_str(), r.depth,
+                            (unsigned long long)r.ops, r.ns, r.ns_per_op(), r.ops_per_sec());
+            } else {
+                std::printf("%-32s %6d %12.2f %16.0f", r.name.c_str(), r.depth,
+                            r.ns_per_op(), r.ops_per_sec());
+            }
+            if (o.counters) {
+                print_counters(r, o.csv);
+            }
+            std::printf("\n");
+            std::fflush(stdout);
+            ++count;
+        }
+
+        if (count == 0) {
+            std::fprintf(stderr, "no benchmarks selected\n");
+            return 1;
+        }
+        return 0;
+    }
+} // namespace bench
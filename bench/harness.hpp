@@ -0,0 +1,111 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "perf.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace bench {
+    // Prevent the compiler from optimising away a value computed inside of a benchmark
+    template <typename Type>
+    inline void keep(const Type& v) noexcept {
+        asm volatile("" : : "r,m"(v) : "memory");
+    }
+
+    // Prevent the compiler from eliding or reordering memory writes around this point
+    inline void clobber() noexcept {
+        asm volatile("" : : : "memory");
+    }
+
+    // Passed to each benchmark function. The function is expected to prepare its data, call start(),
+    // execute its workload "iterations" times, call stop() and finally return the total number of
+    // operations executed, which is used to calculate ns/op and ops/sec. If hardware counters are
+    // enabled, they count between start() and stop() too, outside of the measured time.
+    class state {
+        using clock = std::chrono::steady_clock;
+        clock::time_point begin_ = {};
+        clock::time_point end_ = {};
+        perf* perf_;
+        perf::counts counts_ = {};
+
+    public:
+        explicit state(std::uint64_t n, perf* p = nullptr) : perf_(p), iterations(n) { }
+
+        const std::uint64_t iterations;
+
+        void start() {
+            if (perf_ != nullptr) {
+                perf_->start();
+            }
+            clobber();
+            begin_ = clock::now();
+        }
+
+        void stop() {
+            end_ = clock::now();
+            clobber();
+            if (perf_ != nullptr) {
+                counts_ = perf_->stop();
+            }
+        }
+
+        double elapsed() const { // in nanoseconds
+            return std::chrono::duration<double, std::nano>(end_ - begin_).count();
+        }
+
+        const perf::counts& counts() const { return counts_; }
+    };
+
+    using function = std::function<std::uint64_t(state&)>;
+
+    struct benchmark {
+        std::string name;
+        int depth;
+        function fn;
+    };
+
+    std::vector<benchmark>& registry();
+
+    // Used for static registration of benchmarks, in the style of TEST_CASE
+    struct registrar {
+        registrar(std::string name, int depth, function fn) {
+            registry().push_back(benchmark{std::move(name), depth, std::move(fn)});
+        }
+    };
+
+    struct options {
+        std::string filter = {}; // Substring of benchmark name, empty means all
+        int depth_min = 0;
+        int depth_max = 1 << 30;
+        double min_time = 5e6; // Minimum duration of a single measurement, in nanoseconds
+        int repeat = 3; // Number of measurements, the fastest is reported
+        bool csv = false;
+        bool counters = false; // Report hardware performance counters, where available
+    };
+
+    struct result {
+        std::string name;
+        int depth;
+        std::uint64_t ops;
+        double ns;
+        perf::counts counts = {};
+
+        double ns_per_op() const { return ops == 0 ? 0.0 : ns / (double)ops; }
+        double ops_per_sec() const { return ns == 0.0 ? 0.0 : (double)ops * 1e9 / ns; }
+        // Count of event e per operation, or NaN if not available
+        double per_op(perf::event e) const;
+        // Instructions per cycle, or NaN if not available
+        double ipc() const;
+    };
+
+    result measure(const benchmark& b, const options& o, perf* p = nullptr);
+    int run(const options& o);
+} // namespace bench
@@ -0,0 +1,111 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "harness.hpp"
+#include "level.hpp"
+
+#include "market/ladder.hpp"
+
+#include <utility>
+
+namespace {
+    using namespace bench;
+    using market::side;
+
+    constexpr std::size_t inputs = 1024;
+    constexpr std::size_t mask = inputs - 1;
+
+    // Levels laid out as in fill(), two ticks apart, so Size levels span 4 * Size ticks on both sides
+    using ladder = market::ladder<level, level, 512>;
+
+    template <int Size>
+    void fill(ladder& l) {
+        l.reset();
+        for (int i = 0; i < Size; ++i) {
+            l.insert<side::bid>(level{price<side::bid>(i), 100 + i});
+            l.insert<side::ask>(level{price<side::ask>(i), 100 + i});
+        }
+    }
+
+    // Same as book/churn/top/insert
+    struct churn_top_insert {
+        template <int Size>
+        static std::uint64_t run(state& s) {
+            ladder l;
+            fill<Size>(l);
+            const int top = price<side::bid>(0);
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                l.remove<side::bid>(0);
+                keep(l.insert<side::bid>(level{top + (int)(n & 1), (int)n}));
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    // Top level replaced by price, i.e. without using positions
+    struct churn_top_tick {
+        template <int Size>
+        static std::uint64_t run(state& s) {
+            ladder l;
+            fill<Size>(l);
+            const int top = price<side::bid>(0);
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                keep(l.erase<side::bid>(top + (int)(n & 1)));
+                keep(l.set<side::bid>(level{top + (int)((n + 1) & 1), (int)n}));
+                keep(l.top<side::bid>());
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    // Same queries as book/binary_search
+    struct binary_search {
+        template <int Size>
+        static std::uint64_t run(state& s) {
+            ladder l;
+            fill<Size>(l);
+            const auto q = random(inputs, price<side::bid>(Size) - 1, price<side::bid>(0) + 2);
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                keep(l.binary_search<side::bid>(q[n & mask]));
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    // Lookup by price, O(1)
+    struct get {
+        template <int Size>
+        static std::uint64_t run(state& s) {
+            ladder l;
+            fill<Size>(l);
+            const auto q = random(inputs, price<side::bid>(Size) - 1, price<side::bid>(0) + 2);
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                keep(l.get<side::bid>(q[n & mask]));
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    template <typename Workload, int ... I>
+    bool add(const char* name, std::integer_sequence<int, I...>) {
+        (registrar{name, I, &Workload::template run<I>}, ...);
+        return true;
+    }
+
+    using selected = std::integer_sequence<int, 1, 2, 3, 4, 5, 6, 8, 10, 12, 16, 20, 24, 32, 48, 64, 96, 127>;
+
+    const bool registered = add<churn_top_insert>("ladder/churn/top/insert", selected{})
+            && add<churn_top_tick>("ladder/churn/top/tick", selected{})
+            && add<binary_search>("ladder/binary_search", selected{})
+            && add<get>("ladder/get", selected{});
+}
@@ -0,0 +1,219 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "market/book.hpp"
+
+#include <cstdint>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+namespace bench {
+    // Level layout typical for our feeds, price in ticks and aggregated size
+    struct level {
+        int ticks = 0;
+        int size = 0;
+
+        template <market::side Side>
+        constexpr static bool compare(int lh, int rh) noexcept {
+            if constexpr (Side == market::side::bid) {
+                return lh > rh;
+            } else {
+                return lh < rh;
+            }
+        }
+
+        template <market::side Side>
+        constexpr static bool compare(const level& lh, const level& rh) noexcept {
+            return compare<Side>(lh.ticks, rh.ticks);
+        }
+
+        template <market::side Side>
+        constexpr static bool compare(int lh, const level& rh) noexcept {
+            return compare<Side>(lh, rh.ticks);
+        }
+
+        template <market::side Side>
+        constexpr static bool compare(const level& lh, int rh) noexcept {
+            return compare<Side>(lh.ticks, rh);
+        }
+
+        constexpr static int make(int i) noexcept {
+            return i;
+        }
+
+        // Required by market::ladder
+        constexpr static int tick(int i) noexcept {
+            return i;
+        }
+
+        constexpr static int tick(const level& l) noexcept {
+            return l.ticks;
+        }
+
+        // Required by market::orders
+        constexpr static level open(std::int64_t ticks) noexcept {
+            return level{(int)ticks, 0};
+        }
+
+        constexpr static void adjust(level& l, std::int64_t quantity) noexcept {
+            l.size += (int)quantity;
+        }
+
+        // Required by market::consolidated
+        constexpr static void combine(level& l, const level& other) noexcept {
+            l.size += other.size;
+        }
+    };
+
+    // Same as level, but selects linear search mode
+    struct linear : level {
+        constexpr static auto search_mode = market::search::linear;
+
+        template <market::side Side>
+        constexpr static int key(int i) noexcept {
+            return Side == market::side::bid ? -i : i;
+        }
+
+        template <market::side Side>
+        constexpr static int key(const level& l) noexcept {
+            return key<Side>(l.ticks);
+        }
+    };
+
+    // Same as level, but selects cumulative totals
+    struct totals : level {
+        constexpr static bool cumulative = true;
+
+        constexpr static int quantity(const level& l) noexcept {
+            return l.size;
+        }
+    };
+
+    // Same as level, but selects instrumentation, i.e. counting of events in the book
+    struct counted : level {
+        constexpr static bool instrumented = true;
+    };
+
+    template <int Size, typename Policy = level, typename Index = std::uint8_t>
+    struct fixed_book : market::book<level, Policy, Index> {
+        using book = market::book<level, Policy, Index>;
+
+        fixed_book() : book(data, 0, 0) {
+            reset();
+        }
+
+        using book::reset;
+
+        typename book::template data<Size> data;
+    };
+
+    // Used as the Policy of a benchmark, selects static_book (i.e. capacity known at compile time)
+    template <typename Policy>
+    struct fixed : Policy { };
+
+    template <int Size, typename Policy, typename Index>
+    struct fixed_book<Size, fixed<Policy>, Index> : market::static_book<level, Size, Policy> {
+        static_assert(std::is_same_v<Index, typename market::static_book<level, Size, Policy>::size_type>);
+    };
+
+    // Used as the Policy of a benchmark, selects structure of arrays storage of levels, i.e. separate
+    // arrays of ticks and sizes, where searches only read ticks
+    struct columns : level {
+        struct const_reference {
+            const int* ticks;
+            const int* size;
+
+            constexpr operator level() const noexcept { return level{*ticks, *size}; }
+        };
+
+        struct reference {
+            int* ticks;
+            int* size;
+
+            constexpr reference& operator=(const level& l) noexcept {
+                *ticks = l.ticks;
+                *size = l.size;
+                return *this;
+            }
+
+            constexpr reference& operator=(const reference& o) noexcept {
+                return *this = (level)o;
+            }
+
+            constexpr operator level() const noexcept { return level{*ticks, *size}; }
+            constexpr operator const_reference() const noexcept { return {ticks, size}; }
+        };
+
+        struct storage {
+            int* ticks = nullptr;
+            int* size = nullptr;
+
+            using reference = columns::reference;
+            using const_reference = columns::const_reference;
+
+            constexpr reference operator[](std::size_t i) const noexcept {
+                return {ticks + i, size + i};
+            }
+        };
+
+        constexpr static int ticks(int i) noexcept { return i; }
+        constexpr static int ticks(const level& l) noexcept { return l.ticks; }
+        constexpr static int ticks(const reference& r) noexcept { return *r.ticks; }
+        constexpr static int ticks(const const_reference& r) noexcept { return *r.ticks; }
+
+        template <market::side Side, typename Lh, typename Rh>
+        constexpr static bool compare(const Lh& lh, const Rh& rh) noexcept {
+            return level::compare<Side>(ticks(lh), ticks(rh));
+        }
+    };
+
+    template <int Size, typename Index>
+    struct fixed_book<Size, columns, Index> : market::book<level, columns, Index> {
+        using book = market::book<level, columns, Index>;
+
+        fixed_book() : book(typename book::storage_type{ticks, sizes}, sides, freel, Size, 0, 0) {
+            reset();
+        }
+
+        using book::reset;
+
+        int ticks[Size * 2] = {};
+        int sizes[Size * 2] = {};
+        Index sides[Size * 2] = {};
+        Index freel[Size * 2] = {};
+    };
+
+    // Prices are laid out two ticks apart, so that odd prices between levels can be used for misses
+    constexpr int mid = 100000;
+
+    template <market::side Side>
+    constexpr int price(int i) noexcept {
+        return Side == market::side::bid ? mid - 1 - 2 * i : mid + 1 + 2 * i;
+    }
+
+    // Fill both sides of the book to capacity, sorted
+    template <typename Book>
+    void fill(Book& book) {
+        book.reset();
+        for (int i = 0; i < (int)book.capacity; ++i) {
+            book.template push_back<market::side::bid>(level{price<market::side::bid>(i), 100 + i});
+            book.template push_back<market::side::ask>(level{price<market::side::ask>(i), 100 + i});
+        }
+    }
+
+    // Deterministic pseudo-random data, so results are reproducible between runs
+    inline std::vector<int> random(std::size_t n, int lo, int hi, unsigned seed = 42) {
+        std::mt19937 gen{seed};
+        std::uniform_int_distribution<int> dist{lo, hi};
+        std::vector<int> result(n);
+        for (auto& i : result) {
+            i = dist(gen);
+        }
+        return result;
+    }
+} // namespace bench
@@ -0,0 +1,51 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "harness.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+    int usage(const char* self) {
+        std::fprintf(stderr,
+                     "usage: %s [options] [filter]\n"
+                     "  filter           run only benchmarks with name containing this string\n"
+                     "  --depth N | A-B  run only benchmarks of depth N, or in range A to B\n"
+                     "  --min-time MS    minimum duration of a single measurement, default 5\n"
+                     "  --repeat N       number of measurements, fastest is reported, default 3\n"
+                     "  --csv            print results as comma separated values\n"
+                     "  --counters       report IPC, cache and branch misses per op, if available\n",
+                     self);
+        return 2;
+    }
+}
+
+int main(int argc, char** argv) {
+    bench::options o;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--depth" && i + 1 < argc) {
+            const std::string val = argv[++i];
+            const auto dash = val.find('-');
+            o.depth_min = std::atoi(val.substr(0, dash).c_str());
+            o.depth_max = dash == std::string::npos ? o.depth_min : std::atoi(val.substr(dash + 1).c_str());
+        } else if (arg == "--min-time" && i + 1 < argc) {
+            o.min_time = std::atof(argv[++i]) * 1e6;
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            o.repeat = std::atoi(argv[++i]);
+        } else if (arg == "--csv") {
+            o.csv = true;
+        } else if (arg == "--counters") {
+            o.counters = true;
+        } else if (not arg.empty() && arg[0] != '-' && o.filter.empty()) {
+            o.filter = arg;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    return bench::run(o);
+}
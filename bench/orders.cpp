@@ -0,0 +1,113 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "harness.hpp"
+#include "level.hpp"
+
+#include "market/orders.hpp"
+
+#include <utility>
+
+namespace {
+    using namespace bench;
+    using market::side;
+
+    constexpr std::size_t inputs = 1024;
+    constexpr std::size_t mask = inputs - 1;
+
+    // Number of orders queued at every level
+    constexpr int queue = 4;
+    using orders = market::orders<level>;
+
+    // Size levels on both sides, laid out as in fill(), with order ids assigned level by level
+    template <int Size>
+    void fill(orders& o) {
+        o.clear();
+        for (int i = 0; i < Size; ++i) {
+            for (int j = 0; j < queue; ++j) {
+                o.add<side::bid>((std::uint64_t)(i * queue + j), price<side::bid>(i), 10);
+                o.add<side::ask>((std::uint64_t)((Size + i) * queue + j), price<side::ask>(i), 10);
+            }
+        }
+    }
+
+    // Oldest order at a random level is cancelled and replaced with a new order at the same price,
+    // i.e. the level is never removed
+    struct cancel_add {
+        template <int Size>
+        static std::uint64_t run(state& s) {
+            orders o(Size, Size * queue * 2);
+            fill<Size>(o);
+            const auto pos = random(inputs, 0, Size - 1);
+            std::uint64_t next = (std::uint64_t)(Size * queue * 2);
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                const auto i = pos[n & mask];
+                keep(o.cancel(o.front<side::bid>((orders::size_type)i).id));
+                keep(o.add<side::bid>(next++, price<side::bid>(i), 10));
+            }
+            s.stop();
+            return s.iterations * 2;
+        }
+    };
+
+    // Orders at the top level are executed in small parts, and replaced with new orders when filled
+    struct execute_top {
+        template <int Size>
+        static std::uint64_t run(state& s) {
+            orders o(Size, Size * queue * 2);
+            fill<Size>(o);
+            std::uint64_t next = (std::uint64_t)(Size * queue * 2);
+            const int top = price<side::bid>(0);
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                const auto id = o.front<side::bid>(0).id;
+                if (o.execute(id, 3) == 1) {
+                    keep(o.add<side::bid>(next++, top, 10));
+                }
+            }
+            s.stop();
+            return s.iterations;
+        }
+    };
+
+    // Whole level at a random position is cleared and then filled again, i.e. the level is removed from
+    // and inserted to the book
+    struct level_churn {
+        template <int Size>
+        static std::uint64_t run(state& s) {
+            orders o(Size, Size * queue * 2);
+            fill<Size>(o);
+            const auto pos = random(inputs, 0, Size - 1);
+            std::uint64_t next = (std::uint64_t)(Size * queue * 2);
+            s.start();
+            for (std::uint64_t n = 0; n < s.iterations; ++n) {
+                const auto i = pos[n & mask];
+                const int p = price<side::bid>(i);
+                const auto l = o.book().template binary_search<side::bid>(p);
+                for (int j = 0; j < queue; ++j) {
+                    keep(o.cancel(o.front<side::bid>(l).id));
+                }
+                for (int j = 0; j < queue; ++j) {
+                    keep(o.add<side::bid>(next++, p, 10));
+                }
+            }
+            s.stop();
+            return s.iterations * queue * 2;
+        }
+    };
+
+    template <typename Workload, int ... I>
+    bool add(const char* name, std::integer_sequence<int, I...>) {
+        (registrar{name, I, &Workload::template run<I>}, ...);
+        return true;
+    }
+
+    using depths = std::integer_sequence<int, 1, 5, 10, 20, 50, 100>;
+
+    const bool registered = add<cancel_add>("orders/cancel_add", depths{})
+            && add<execute_top>("orders/execute_top", depths{})
+            && add<level_churn>("orders/level_churn", depths{});
+}
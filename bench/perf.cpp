@@ -0,0 +1,101 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "perf.hpp"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace bench {
+#if defined(__linux__)
+    namespace {
+        int open_(std::uint32_t type, std::uint64_t config) {
+            perf_event_attr attr = {};
+            attr.size = sizeof(attr);
+            attr.type = type;
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+    }
+
+    perf::perf() {
+        constexpr std::uint64_t l1d_read_miss = PERF_COUNT_HW_CACHE_L1D
+                | ((std::uint64_t)PERF_COUNT_HW_CACHE_OP_READ << 8)
+                | ((std::uint64_t)PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        fds_[(int)event::cycles] = open_(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        fds_[(int)event::instructions] = open_(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        fds_[(int)event::l1d_misses] = open_(PERF_TYPE_HW_CACHE, l1d_read_miss);
+        fds_[(int)event::llc_misses] = open_(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        fds_[(int)event::branch_misses] = open_(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        if (not any()) {
+            error_ = std::strerror(errno);
+        }
+    }
+
+    perf::~perf() {
+        for (const int fd : fds_) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    void perf::start() {
+        for (const int fd : fds_) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+    }
+
+    perf::counts perf::stop() {
+        for (const int fd : fds_) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+        }
+        counts result;
+        for (int i = 0; i < event_count; ++i) {
+            std::uint64_t v[3]; // value, time enabled, time running
+            if (fds_[i] < 0 || read(fds_[i], v, sizeof(v)) != (ssize_t)sizeof(v) || v[2] == 0) {
+                continue;
+            }
+            result.values[i] = (double)v[0] * ((double)v[1] / (double)v[2]);
+            result.valid[i] = true;
+        }
+        return result;
+    }
+#else
+    perf::perf() : error_("not supported on this platform") {
+        fds_.fill(-1);
+    }
+
+    perf::~perf() = default;
+
+    void perf::start() { }
+
+    perf::counts perf::stop() {
+        return {};
+    }
+#endif
+
+    bool perf::any() const {
+        return std::any_of(fds_.begin(), fds_.end(), [](int fd) { return fd >= 0; });
+    }
+} // namespace bench
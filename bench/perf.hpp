@@ -0,0 +1,52 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace bench {
+    // Hardware performance counters of the calling thread, counting in user space only, opened with
+    // Linux perf_event_open. Each counter is opened separately, so if some of them are not supported
+    // the others still work; if none can be opened (e.g. in a container, or if disallowed by
+    // perf_event_paranoid, or on other platforms) all counts are unavailable and error() says why.
+    class perf {
+    public:
+        enum class event : int {
+            cycles,
+            instructions,
+            l1d_misses, // L1 data cache read misses
+            llc_misses, // Last level cache misses
+            branch_misses,
+        };
+        constexpr static int event_count = 5;
+
+        // Counts of events between start() and stop(), scaled if the counters were multiplexed
+        struct counts {
+            std::array<double, event_count> values = {};
+            std::array<bool, event_count> valid = {};
+
+            bool available(event e) const { return valid[(int)e]; }
+            double operator[](event e) const { return values[(int)e]; }
+        };
+
+        perf();
+        ~perf();
+        perf(const perf& ) = delete;
+        perf& operator=(const perf& ) = delete;
+
+        bool any() const;
+        const std::string& error() const { return error_; }
+
+        void start();
+        counts stop();
+
+    private:
+        std::array<int, event_count> fds_;
+        std::string error_;
+    };
+} // namespace bench
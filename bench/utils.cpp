@@ -0,0 +1,61 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "harness.hpp"
+
+#include "common/utils.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+namespace {
+    using namespace bench;
+
+    // Shift of book indices by one element, as in remove() (left) and insert() (right). The number
+    // of elements shifted is reported as depth.
+    template <typename Fn>
+    std::uint64_t shift(state& s, int n, Fn fn) {
+        std::uint8_t data[256] = {};
+        for (int i = 0; i < 256; ++i) {
+            data[i] = (std::uint8_t)i;
+        }
+        s.start();
+        for (std::uint64_t i = 0; i < s.iterations; ++i) {
+            fn(data + 1, data, (std::size_t)n);
+            keep(data);
+            fn(data, data + 1, (std::size_t)n);
+            keep(data);
+        }
+        s.stop();
+        return s.iterations * 2;
+    }
+
+    void scalar(std::uint8_t* dst, const std::uint8_t* src, std::size_t n) {
+        if (dst < src) {
+            for (std::size_t i = 0; i < n; ++i) {
+                dst[i] = src[i];
+                clobber(); // Prevent the compiler from replacing the loop with memmove
+            }
+        } else {
+            for (std::size_t i = n; i > 0; --i) {
+                dst[i - 1] = src[i - 1];
+                clobber();
+            }
+        }
+    }
+
+    const bool registered = [] {
+        for (int n = 1; n <= 127; ++n) {
+            registrar{"shift/scalar", n, [n](state& s) { return shift(s, n, scalar); }};
+            registrar{"shift/memmove", n, [n](state& s) {
+                return shift(s, n, [](auto* d, auto* p, std::size_t i) { std::memmove(d, p, i); });
+            }};
+            registrar{"shift/common", n, [n](state& s) {
+                return shift(s, n, [](auto* d, auto* p, std::size_t i) { common::shift(d, p, i); });
+            }};
+        }
+        return true;
+    }();
+}
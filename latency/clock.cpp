@@ -0,0 +1,33 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "clock.hpp"
+
+#include <algorithm>
+
+namespace latency {
+    calibration calibrate(std::chrono::milliseconds duration) {
+        using clock = std::chrono::steady_clock;
+        calibration result;
+
+        const auto t0 = clock::now();
+        const auto c0 = tsc::start();
+        while (clock::now() - t0 < duration) {
+        }
+        const auto c1 = tsc::stop();
+        const auto t1 = clock::now();
+        const auto ns = std::chrono::duration<double, std::nano>(t1 - t0).count();
+        result.ticks_per_ns = ns > 0.0 && c1 > c0 ? (double)(c1 - c0) / ns : 1.0;
+
+        auto overhead = ~(std::uint64_t)0;
+        for (int i = 0; i < 100000; ++i) {
+            const auto a = tsc::start();
+            const auto b = tsc::stop();
+            overhead = std::min(overhead, b - a);
+        }
+        result.overhead = overhead;
+        return result;
+    }
+} // namespace latency
@@ -0,0 +1,59 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace latency {
+    // Time stamp counter, read with fences so that the measured operation cannot be reordered
+    // before start() or after stop(). On platforms other than x86 falls back to steady_clock, with
+    // one tick per nanosecond.
+    struct tsc {
+        static std::uint64_t start() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+            _mm_lfence();
+            const auto t = __rdtsc();
+            _mm_lfence();
+            return t;
+#else
+            return now_();
+#endif
+        }
+
+        static std::uint64_t stop() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+            unsigned aux;
+            const auto t = __rdtscp(&aux);
+            _mm_lfence();
+            return t;
+#else
+            return now_();
+#endif
+        }
+
+    private:
+        static std::uint64_t now_() noexcept {
+            const auto t = std::chrono::steady_clock::now().time_since_epoch();
+            return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t).count();
+        }
+    };
+
+    struct calibration {
+        double ticks_per_ns = 1.0;
+        std::uint64_t overhead = 0; // Ticks measured between start() and stop() with nothing in between
+
+        double ns(std::uint64_t ticks) const noexcept { return (double)ticks / ticks_per_ns; }
+    };
+
+    // Measure the frequency of tsc against steady_clock over the given duration, and the overhead of
+    // a single measurement (the minimum of many, which is subtracted from all measurements)
+    calibration calibrate(std::chrono::milliseconds duration);
+} // namespace latency
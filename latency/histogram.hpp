@@ -0,0 +1,89 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace latency {
+    // Log-linear histogram of non-negative values (e.g. ticks), in the style of HdrHistogram. Values
+    // smaller than 2^SubBits are counted exactly, and every larger power of two range is split into
+    // 2^SubBits buckets of equal width, so the relative error of reported values is at most
+    // 2^-SubBits (about 3% by default). Recording is O(1) and does not allocate.
+    template <int SubBits = 5>
+    class histogram {
+        static_assert(SubBits > 0 && SubBits < 16);
+        constexpr static std::uint64_t sub = 1ull << SubBits;
+        constexpr static std::size_t buckets = (std::size_t)(65 - SubBits) * sub;
+
+        std::array<std::uint64_t, buckets> counts_ = {};
+        std::uint64_t count_ = 0;
+        std::uint64_t min_ = ~(std::uint64_t)0;
+        std::uint64_t max_ = 0;
+        double sum_ = 0.0;
+
+        static std::size_t index_(std::uint64_t v) noexcept {
+            if (v < sub) {
+                return (std::size_t)v;
+            }
+            const int shift = 63 - std::countl_zero(v) - SubBits;
+            return (std::size_t)(shift + 1) * sub + (std::size_t)((v >> shift) - sub);
+        }
+
+        // Largest value counted in bucket i
+        static std::uint64_t highest_(std::size_t i) noexcept {
+            if (i < sub) {
+                return i;
+            }
+            const auto shift = (int)(i / sub) - 1;
+            return ((sub + i % sub) << shift) + ((1ull << shift) - 1);
+        }
+
+    public:
+        void record(std::uint64_t v) noexcept {
+            ++counts_[index_(v)];
+            ++count_;
+            min_ = std::min(min_, v);
+            max_ = std::max(max_, v);
+            sum_ += (double)v;
+        }
+
+        void merge(const histogram& o) noexcept {
+            for (std::size_t i = 0; i < buckets; ++i) {
+                counts_[i] += o.counts_[i];
+            }
+            count_ += o.count_;
+            min_ = std::min(min_, o.min_);
+            max_ = std::max(max_, o.max_);
+            sum_ += o.sum_;
+        }
+
+        std::uint64_t count() const noexcept { return count_; }
+        std::uint64_t min() const noexcept { return count_ == 0 ? 0 : min_; }
+        std::uint64_t max() const noexcept { return max_; }
+        double mean() const noexcept { return count_ == 0 ? 0.0 : sum_ / (double)count_; }
+
+        // Smallest value v such that at least p percent of recorded values are not greater than v,
+        // rounded up to the end of its bucket (but not above the maximum recorded)
+        std::uint64_t percentile(double p) const noexcept {
+            if (count_ == 0) {
+                return 0;
+            }
+            const auto rank = std::max<std::uint64_t>(1, (std::uint64_t)((double)count_ * p / 100.0 + 0.5));
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < buckets; ++i) {
+                seen += counts_[i];
+                if (seen >= rank) {
+                    return std::min(highest_(i), max_);
+                }
+            }
+            return max_;
+        }
+    };
+} // namespace latency
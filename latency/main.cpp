@@ -0,0 +1,290 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "clock.hpp"
+#include "histogram.hpp"
+#include "../bench/level.hpp"
+
+#include "common/cpu.hpp"
+#include "market/book.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+    using bench::level;
+
+    using book_type = market::book<level, level, std::uint16_t>;
+    using size_type = book_type::size_type;
+
+    // Capacity selected at run time, so the depth can be given on command line
+    struct dynamic_book : book_type {
+        std::unique_ptr<level[]> levels_;
+        std::unique_ptr<size_type[]> sides_;
+        std::unique_ptr<size_type[]> freel_;
+
+        explicit dynamic_book(int capacity)
+                : book_type(nullptr, nullptr, nullptr, capacity, 0, 0)
+                , levels_(new level[(std::size_t)capacity * 2])
+                , sides_(new size_type[(std::size_t)capacity * 2])
+                , freel_(new size_type[(std::size_t)capacity * 2]) {
+            this->levels = levels_.get();
+            this->sides = sides_.get();
+            this->freel = freel_.get();
+            reset();
+        }
+
+        using book_type::reset;
+    };
+
+    enum class operation : int {
+        insert,
+        remove,
+        binary_search,
+        lower_bound,
+        resort_one,
+    };
+    constexpr int operation_count = 5;
+    constexpr const char* names[operation_count] = {"insert", "remove", "binary_search", "lower_bound", "resort_one"};
+
+    using histogram = latency::histogram<>;
+    using weights = std::array<int, operation_count>;
+
+    struct options {
+        std::vector<int> depths = {10, 127, 1000};
+        weights mix = {2, 2, 3, 3, 1};
+        std::uint64_t samples = 1000000;
+        std::uint64_t warmup = 100000;
+        std::uint64_t seed = 1;
+        int cpu = -1;
+        bool csv = false;
+    };
+
+    int usage(const char* self) {
+        std::fprintf(stderr,
+                     "usage: %s [options]\n"
+                     "  --depth N,...     depths of the book to measure, default 10,127,1000\n"
+                     "  --mix OP:W,...    relative weights of operations, default\n"
+                     "                    insert:2,remove:2,binary_search:3,lower_bound:3,resort_one:1\n"
+                     "  --samples N       number of measured operations per depth, default 1000000\n"
+                     "  --warmup N        number of operations before measurement, default 100000\n"
+                     "  --cpu N           pin to this CPU, default the CPU the harness started on\n"
+                     "  --seed N          seed of random number generator, default 1\n"
+                     "  --csv             print results as comma separated values\n",
+                     self);
+        return 2;
+    }
+
+    std::vector<std::string> split(const std::string& s, char sep) {
+        std::vector<std::string> result;
+        std::size_t b = 0;
+        for (auto e = s.find(sep); e != std::string::npos; e = s.find(sep, b)) {
+            result.push_back(s.substr(b, e - b));
+            b = e + 1;
+        }
+        result.push_back(s.substr(b));
+        return result;
+    }
+
+    bool parse_depths(const std::string& s, std::vector<int>& depths) {
+        depths.clear();
+        for (const auto& d : split(s, ',')) {
+            const int n = std::atoi(d.c_str());
+            // Capacity of each side is twice the depth, to leave space for churn
+            if (n <= 0 || n > book_type::max_capacity / 2) {
+                return false;
+            }
+            depths.push_back(n);
+        }
+        return true;
+    }
+
+    bool parse_mix(const std::string& s, weights& mix) {
+        mix = {};
+        for (const auto& m : split(s, ',')) {
+            const auto colon = m.find(':');
+            const auto name = m.substr(0, colon);
+            const int w = colon == std::string::npos ? 1 : std::atoi(m.substr(colon + 1).c_str());
+            int i = 0;
+            for (; i < operation_count && name != names[i]; ++i) {
+            }
+            if (i == operation_count || w < 0) {
+                return false;
+            }
+            mix[i] = w;
+        }
+        return true;
+    }
+
+    volatile std::uint64_t sink;
+
+    // Perform operation o on Side and return the number of ticks it took. Arguments are generated
+    // up-front, so that only the operation itself is measured
+    template <market::side Side>
+    std::uint64_t measure(dynamic_book& book, operation o, int ticks, std::uint32_t r) {
+        using latency::tsc;
+        std::uint64_t t0 = 0, t1 = 0;
+        switch (o) {
+        case operation::insert: {
+            const level l{ticks, (int)r};
+            t0 = tsc::start();
+            const auto i = book.insert<Side>(l);
+            t1 = tsc::stop();
+            sink = i;
+            break;
+        }
+        case operation::remove: {
+            const auto i = (size_type)(r % book.size<Side>());
+            t0 = tsc::start();
+            book.remove<Side>(i);
+            t1 = tsc::stop();
+            break;
+        }
+        case operation::binary_search: {
+            t0 = tsc::start();
+            const auto i = book.binary_search<Side>(ticks);
+            t1 = tsc::stop();
+            sink = i;
+            break;
+        }
+        case operation::lower_bound: {
+            t0 = tsc::start();
+            const auto i = book.lower_bound<Side>(ticks);
+            t1 = tsc::stop();
+            sink = i;
+            break;
+        }
+        case operation::resort_one: {
+            const auto i = (size_type)(r % book.size<Side>());
+            t0 = tsc::start();
+            book.at<Side>(i).ticks = ticks;
+            const auto j = book.resort_one<Side>(i);
+            t1 = tsc::stop();
+            sink = j;
+            break;
+        }
+        }
+        return t1 - t0;
+    }
+
+    // Run the mix of operations on a book kept around the given depth, on both sides. Operations
+    // which cannot be performed (insert on a full side, or remove and resort_one on an empty side)
+    // are replaced with insert or remove, so the size of the book follows a random walk.
+    void run(int depth, const options& o, const latency::calibration& c, std::array<histogram, operation_count>& result) {
+        using market::side;
+        const int capacity = depth * 2;
+        dynamic_book book(capacity);
+        std::mt19937_64 gen(o.seed);
+        // Prices are drawn from twice the depth, so about half of the ticks are occupied
+        std::uniform_int_distribution<int> price(0, depth * 2 - 1);
+        std::discrete_distribution<int> choice(o.mix.begin(), o.mix.end());
+        for (int i = 0; i < depth; ++i) {
+            book.insert<side::bid>(level{price(gen), i});
+            book.insert<side::ask>(level{price(gen), i});
+        }
+
+        for (std::uint64_t n = 0; n < o.warmup + o.samples; ++n) {
+            const bool bid = (gen() & 1) != 0;
+            const auto size = bid ? book.size<side::bid>() : book.size<side::ask>();
+            auto op = (operation)choice(gen);
+            if (op == operation::insert && size == capacity) {
+                op = operation::remove;
+            } else if ((op == operation::remove || op == operation::resort_one) && size == 0) {
+                op = operation::insert;
+            }
+            const int ticks = price(gen);
+            const auto r = (std::uint32_t)gen();
+            const auto t = bid ? measure<side::bid>(book, op, ticks, r) : measure<side::ask>(book, op, ticks, r);
+            if (n >= o.warmup) {
+                result[(int)op].record(t > c.overhead ? t - c.overhead : 0);
+            }
+        }
+    }
+
+    void print(int depth, const char* name, const histogram& h, const latency::calibration& c, bool csv) {
+        if (h.count() == 0) {
+            return;
+        }
+        constexpr double percentiles[] = {50.0, 90.0, 99.0, 99.9, 99.99};
+        if (csv) {
+            std::printf("%d,%s,%llu,%.1f", depth, name, (unsigned long long)h.count(), c.ns(h.min()));
+            for (const auto p : percentiles) {
+                std::printf(",%.1f", c.ns(h.percentile(p)));
+            }
+            std::printf(",%.1f,%.1f\n", c.ns(h.max()), h.mean() / c.ticks_per_ns);
+        } else {
+            std::printf("%6d %-14s %10llu %8.1f", depth, name, (unsigned long long)h.count(), c.ns(h.min()));
+            for (const auto p : percentiles) {
+                std::printf(" %8.1f", c.ns(h.percentile(p)));
+            }
+            std::printf(" %10.1f %8.1f\n", c.ns(h.max()), h.mean() / c.ticks_per_ns);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    options o;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--depth" && i + 1 < argc) {
+            if (not parse_depths(argv[++i], o.depths)) {
+                return usage(argv[0]);
+            }
+        } else if (arg == "--mix" && i + 1 < argc) {
+            if (not parse_mix(argv[++i], o.mix)) {
+                return usage(argv[0]);
+            }
+        } else if (arg == "--samples" && i + 1 < argc) {
+            o.samples = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--warmup" && i + 1 < argc) {
+            o.warmup = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--cpu" && i + 1 < argc) {
+            o.cpu = std::atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            o.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--csv") {
+            o.csv = true;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (std::all_of(o.mix.begin(), o.mix.end(), [](int w) { return w == 0; })) {
+        return usage(argv[0]);
+    }
+
+    const int cpu = common::pin(o.cpu);
+    if (cpu < 0) {
+        std::fprintf(stderr, "warning: failed to pin to cpu %d, results may be noisy\n", o.cpu);
+    }
+    const auto c = latency::calibrate(std::chrono::milliseconds(200));
+
+    if (o.csv) {
+        std::printf("depth,operation,count,min,p50,p90,p99,p99.9,p99.99,max,mean\n");
+    } else {
+        std::printf("cpu %d, %.3f ticks/ns, overhead %llu ticks subtracted, all times in ns\n", cpu,
+                    c.ticks_per_ns, (unsigned long long)c.overhead);
+        std::printf("%6s %-14s %10s %8s %8s %8s %8s %8s %8s %10s %8s\n", "depth", "operation", "count", "min",
+                    "p50", "p90", "p99", "p99.9", "p99.99", "max", "mean");
+    }
+    for (const int depth : o.depths) {
+        std::array<histogram, operation_count> result;
+        run(depth, o, c, result);
+        histogram all;
+        for (int i = 0; i < operation_count; ++i) {
+            print(depth, names[i], result[i], c, o.csv);
+            all.merge(result[i]);
+        }
+        print(depth, "all", all, c, o.csv);
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "cpu.hpp"
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace common {
+#if defined(__linux__)
+    namespace {
+        bool set_affinity(pthread_t thread, int cpu) {
+            if (cpu < 0 || cpu >= CPU_SETSIZE) {
+                return false;
+            }
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            return pthread_setaffinity_np(thread, sizeof(set), &set) == 0;
+        }
+    }
+
+    bool pin(std::thread& thread, int cpu) {
+        return set_affinity(thread.native_handle(), cpu);
+    }
+
+    int pin(int cpu) {
+        if (cpu < 0) {
+            cpu = sched_getcpu();
+        }
+        return set_affinity(pthread_self(), cpu) ? cpu : -1;
+    }
+#else
+    bool pin(std::thread& , int ) {
+        return false;
+    }
+
+    int pin(int ) {
+        return -1;
+    }
+#endif
+} // namespace common
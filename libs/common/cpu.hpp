@@ -0,0 +1,17 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include <thread>
+
+namespace common {
+    // Pin thread to the given CPU. Returns false if not supported or failed.
+    bool pin(std::thread& thread, int cpu);
+
+    // Pin the calling thread to the given CPU, or to the CPU it is currently running on if negative.
+    // Returns the CPU pinned to, or -1 if not supported or failed.
+    int pin(int cpu);
+} // namespace common
@@ -5,9 +5,16 @@
 
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <type_traits>
 #include <utility>
 
+#if defined(__SSE2__)
+# include <immintrin.h>
+#endif
+
 // Allow custom ASSERT macro
 #ifndef ASSERT
 # include <cassert>
@@ -60,4 +67,102 @@ namespace common {
     static Type* emplace(void* dst, Args&& ... a) noexcept {
         return impl::emplace_impl<Type>::fn(dst, std::forward<Args>(a)...);
     }
+
+    namespace impl {
+        // Equivalent of memmove, optimised for small sizes where source and destination overlap, e.g.
+        // when shifting an array by one element. All loads are performed before any store, which is
+        // what makes overlapping ranges safe. Larger sizes are delegated to memmove.
+        inline void move_bytes(void* dst, const void* src, std::size_t n) noexcept {
+            auto* const d = static_cast<unsigned char*>(dst);
+            const auto* const s = static_cast<const unsigned char*>(src);
+            if (n <= 16) {
+                if (n >= 8) {
+                    std::uint64_t a, b;
+                    std::memcpy(&a, s, 8);
+                    std::memcpy(&b, s + n - 8, 8);
+                    std::memcpy(d, &a, 8);
+                    std::memcpy(d + n - 8, &b, 8);
+                } else if (n >= 4) {
+                    std::uint32_t a, b;
+                    std::memcpy(&a, s, 4);
+                    std::memcpy(&b, s + n - 4, 4);
+                    std::memcpy(d, &a, 4);
+                    std::memcpy(d + n - 4, &b, 4);
+                } else if (n >= 2) {
+                    std::uint16_t a, b;
+                    std::memcpy(&a, s, 2);
+                    std::memcpy(&b, s + n - 2, 2);
+                    std::memcpy(d, &a, 2);
+                    std::memcpy(d + n - 2, &b, 2);
+                } else if (n == 1) {
+                    *d = *s;
+                }
+                return;
+            }
+#if defined(__AVX2__)
+            if (n <= 32) {
+                const auto a = _mm_loadu_si128((const __m128i*)s);
+                const auto b = _mm_loadu_si128((const __m128i*)(s + n - 16));
+                _mm_storeu_si128((__m128i*)d, a);
+                _mm_storeu_si128((__m128i*)(d + n - 16), b);
+            } else if (n <= 64) {
+                const auto a = _mm256_loadu_si256((const __m256i*)s);
+                const auto b = _mm256_loadu_si256((const __m256i*)(s + n - 32));
+                _mm256_storeu_si256((__m256i*)d, a);
+                _mm256_storeu_si256((__m256i*)(d + n - 32), b);
+            } else if (n <= 128) {
+                const auto a = _mm256_loadu_si256((const __m256i*)s);
+                const auto b = _mm256_loadu_si256((const __m256i*)(s + 32));
+                const auto c = _mm256_loadu_si256((const __m256i*)(s + n - 64));
+                const auto e = _mm256_loadu_si256((const __m256i*)(s + n - 32));
+                _mm256_storeu_si256((__m256i*)d, a);
+                _mm256_storeu_si256((__m256i*)(d + 32), b);
+                _mm256_storeu_si256((__m256i*)(d + n - 64), c);
+                _mm256_storeu_si256((__m256i*)(d + n - 32), e);
+            } else {
+                std::memmove(d, s, n);
+            }
+#elif defined(__SSE2__)
+            if (n <= 32) {
+                const auto a = _mm_loadu_si128((const __m128i*)s);
+                const auto b = _mm_loadu_si128((const __m128i*)(s + n - 16));
+                _mm_storeu_si128((__m128i*)d, a);
+                _mm_storeu_si128((__m128i*)(d + n - 16), b);
+            } else if (n <= 64) {
+                const auto a = _mm_loadu_si128((const __m128i*)s);
+                const auto b = _mm_loadu_si128((const __m128i*)(s + 16));
+                const auto c = _mm_loadu_si128((const __m128i*)(s + n - 32));
+                const auto e = _mm_loadu_si128((const __m128i*)(s + n - 16));
+                _mm_storeu_si128((__m128i*)d, a);
+                _mm_storeu_si128((__m128i*)(d + 16), b);
+                _mm_storeu_si128((__m128i*)(d + n - 32), c);
+                _mm_storeu_si128((__m128i*)(d + n - 16), e);
+            } else {
+                std::memmove(d, s, n);
+            }
+#else
+            std::memmove(d, s, n);
+#endif
+        }
+    }
+
+    // Move n elements from src to dst, where both ranges may overlap. Used for shifting arrays of
+    // indices, hence restricted to trivially copyable types. Scalar loop in constant evaluation.
+    template <typename Type>
+    constexpr void shift(Type* dst, const Type* src, std::size_t n) noexcept {
+        static_assert(std::is_trivially_copyable_v<Type>);
+        if (std::is_constant_evaluated()) {
+            if (dst < src) {
+                for (std::size_t i = 0; i < n; ++i) {
+                    dst[i] = src[i];
+                }
+            } else {
+                for (std::size_t i = n; i > 0; --i) {
+                    dst[i - 1] = src[i - 1];
+                }
+            }
+        } else {
+            impl::move_bytes(dst, src, n * sizeof(Type));
+        }
+    }
 } // namespace common
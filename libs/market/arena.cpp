@@ -0,0 +1,60 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "arena.hpp"
+
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+#include <sys/mman.h>
+
+namespace market {
+    namespace {
+        constexpr std::size_t huge_page_size = 2 * 1024 * 1024;
+    }
+
+    region::region(std::size_t size, bool huge_pages) {
+        if (size == 0) {
+            return;
+        }
+#if defined(MAP_HUGETLB)
+        if (huge_pages) {
+            const auto rounded = (size + huge_page_size - 1) & ~(huge_page_size - 1);
+            void* const data = ::mmap(nullptr, rounded, PROT_READ | PROT_WRITE,
+                                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (data != MAP_FAILED) {
+                data_ = data;
+                size_ = rounded;
+                huge_ = true;
+                return;
+            }
+        }
+#endif
+        void* const data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "mmap");
+        }
+#if defined(MADV_HUGEPAGE)
+        if (huge_pages) {
+            ::madvise(data, size, MADV_HUGEPAGE); // Advisory only, failure is not an error
+        }
+#endif
+        data_ = data;
+        size_ = size;
+    }
+
+    region::region(region&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr))
+        , size_(std::exchange(other.size_, 0))
+        , huge_(std::exchange(other.huge_, false))
+    { }
+
+    region::~region() {
+        if (data_ != nullptr) {
+            ::munmap(data_, size_);
+        }
+    }
+} // namespace market
@@ -0,0 +1,214 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "book.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace market {
+    // Anonymous memory mapping, zero-initialised. If huge pages are requested but cannot be allocated
+    // (e.g. none are reserved in the system), falls back to regular pages with transparent huge pages
+    // advised. Failure to allocate memory is reported as system_error.
+    class region {
+        void* data_ = nullptr;
+        std::size_t size_ = 0;
+        bool huge_ = false;
+
+    public:
+        explicit region(std::size_t size, bool huge_pages = false);
+        region(region&& other) noexcept;
+        region& operator=(region&& ) = delete;
+        ~region();
+
+        void* data() const { return data_; }
+        std::size_t size() const { return size_; }
+        // True if backed by explicitly allocated huge pages
+        bool huge() const { return huge_; }
+    };
+
+    // Storage for "count" books of the same capacity, allocated in a single region. Books are assigned
+    // to instrument ids with acquire() and returned with release(), which makes the slot available for
+    // reuse by another instrument. Ids are expected to be dense, since they index an array of slots
+    // sized by the largest id seen; ids not smaller than max_ids are rejected. Layout of a slot is:
+    //
+    //   levels[capacity * 2] | sides[capacity * 2] | freel[capacity * 2] | keys | totals
+    //
+    // Every slot and every array in it starts at a multiple of 64 bytes. Array "keys" is only
+    // present for books using linear search mode, and "totals" for books with cumulative totals.
+    template <typename Level, typename Policy = Level, typename Index = uint8_t>
+    class arena {
+    public:
+        using book_type = market::book<Level, Policy, Index>;
+        using level = typename book_type::level;
+        using size_type = typename book_type::size_type;
+        using key_type = typename book_type::key_type;
+        using total_type = typename book_type::total_type;
+        using id_type = std::uint32_t;
+        constexpr static id_type npos = (id_type)(-1);
+        constexpr static id_type max_ids = 1u << 24;
+        static_assert(std::is_trivially_copyable_v<level>);
+
+        struct layout {
+            constexpr static std::size_t align(std::size_t n) { return (n + 63) & ~(std::size_t)63; }
+
+            const std::size_t capacity;
+            const std::size_t levels = 0;
+            const std::size_t sides = levels + align(sizeof(level) * capacity * 2);
+            const std::size_t freel = sides + align(sizeof(size_type) * capacity * 2);
+            const std::size_t keys = freel + align(sizeof(size_type) * capacity * 2);
+            const std::size_t totals = keys + (book_type::linear ? align(sizeof(key_type) * capacity * 2) : 0);
+            const std::size_t stride = totals + (book_type::cumulative ? align(sizeof(total_type) * capacity * 2) : 0);
+        };
+
+        // Book stored in a slot of the arena
+        struct handle : book_type {
+            handle(std::byte* slot, const layout& l)
+                    : book_type(reinterpret_cast<level*>(slot + l.levels),
+                                reinterpret_cast<size_type*>(slot + l.sides),
+                                reinterpret_cast<size_type*>(slot + l.freel),
+                                (int)l.capacity, 0, 0) {
+                if constexpr (book_type::linear) {
+                    this->keys = reinterpret_cast<key_type*>(slot + l.keys);
+                }
+                if constexpr (book_type::cumulative) {
+                    this->totals = reinterpret_cast<total_type*>(slot + l.totals);
+                }
+                reset();
+            }
+
+            using book_type::reset;
+
+            // Index in levels of the level at position i on Side, and the level at that index. Meant
+            // for readers racing with a writer, which must check the index is below capacity * 2
+            template <side Side>
+            size_type slot(size_type i) const {
+                return this->sides[(std::size_t)Side * this->capacity + i];
+            }
+
+            const level& get(size_type slot) const {
+                return this->levels[slot];
+            }
+        };
+
+        arena(std::size_t count, int capacity, bool huge_pages = false)
+                : layout_{check(capacity)}
+                , region_(layout_.stride * count, huge_pages)
+                , owners_(count, npos) {
+            auto* const base = static_cast<std::byte*>(region_.data());
+            books_.reserve(count);
+            free_.reserve(count);
+            for (std::size_t i = 0; i < count; ++i) {
+                books_.emplace_back(base + layout_.stride * i, layout_);
+                free_.push_back((id_type)(count - 1 - i)); // Lowest slot is reused first
+            }
+        }
+
+        // Total number of slots
+        std::size_t size() const { return books_.size(); }
+        // Number of slots assigned to instruments
+        std::size_t used() const { return books_.size() - free_.size(); }
+        const region& memory() const { return region_; }
+
+        // Assign an empty book to instrument id, or return the book already assigned to it. Returns
+        // nullptr if all slots are used, or id is not smaller than max_ids.
+        handle* acquire(id_type id) {
+            if (id >= max_ids) {
+                return nullptr;
+            }
+            if (id < slots_.size() && slots_[id] != npos) {
+                return &books_[slots_[id]];
+            }
+            if (free_.empty()) {
+                return nullptr;
+            }
+            if (id >= slots_.size()) {
+                slots_.resize((std::size_t)id + 1, npos);
+            }
+            const auto s = free_.back();
+            free_.pop_back();
+            slots_[id] = s;
+            owners_[s] = id;
+            return &books_[s];
+        }
+
+        // Return the book assigned to instrument id to the arena, for reuse by another instrument.
+        // Returns false if no book was assigned.
+        bool release(id_type id) {
+            if (id >= slots_.size() || slots_[id] == npos) {
+                return false;
+            }
+            const auto s = slots_[id];
+            books_[s].reset();
+            slots_[id] = npos;
+            owners_[s] = npos;
+            free_.push_back(s);
+            return true;
+        }
+
+        // Book assigned to instrument id or nullptr
+        handle* find(id_type id) {
+            return (id < slots_.size() && slots_[id] != npos) ? &books_[slots_[id]] : nullptr;
+        }
+
+        const handle* find(id_type id) const {
+            return (id < slots_.size() && slots_[id] != npos) ? &books_[slots_[id]] : nullptr;
+        }
+
+        // Book assigned to instrument id, which must exist
+        handle& operator[](id_type id) {
+            ASSERT(find(id) != nullptr);
+            return books_[slots_[id]];
+        }
+
+        const handle& operator[](id_type id) const {
+            ASSERT(find(id) != nullptr);
+            return books_[slots_[id]];
+        }
+
+        // Instrument id assigned to slot s, or npos
+        id_type owner(std::size_t s) const {
+            return owners_[s];
+        }
+
+        // Remove all levels from all books, but keep them assigned to instruments
+        void reset() {
+            for (std::size_t s = 0; s < books_.size(); ++s) {
+                if (owners_[s] != npos) {
+                    books_[s].reset();
+                }
+            }
+        }
+
+        // Visit books assigned to instruments, in the order of slots (i.e. of memory addresses)
+        template <typename Fn>
+        void for_each(Fn&& fn) {
+            for (std::size_t s = 0; s < books_.size(); ++s) {
+                if (owners_[s] != npos) {
+                    fn(owners_[s], books_[s]);
+                }
+            }
+        }
+
+    private:
+        static std::size_t check(int capacity) {
+            if (capacity <= 0 || capacity > book_type::max_capacity) {
+                throw typename book_type::bad_capacity(capacity);
+            }
+            return (std::size_t)capacity;
+        }
+
+        const layout layout_;
+        region region_;
+        std::vector<handle> books_;
+        std::vector<id_type> free_; // Stack of free slots
+        std::vector<id_type> slots_; // Instrument id to slot
+        std::vector<id_type> owners_; // Slot to instrument id
+    };
+} // namespace market
@@ -8,6 +8,12 @@
 #include "common/utils.hpp"
 #include "market.hpp"
 
+#include <bit>
+#include <compare>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <span>
 #include <utility>
 #include <cstddef>
 #include <cstdint>
@@ -15,10 +21,31 @@
 #include <algorithm>
 
 namespace market {
-    template <typename Level, typename Policy = Level>
+    namespace impl {
+        // Storage of levels in class book: an array of Level, unless the Policy provides member type
+        // "storage", see below
+        template <typename Level, typename Policy>
+        struct storage {
+            using type = Level*;
+            using reference = Level&;
+            using const_reference = const Level&;
+        };
+
+        template <typename Level, typename Policy> requires requires { typename Policy::storage; }
+        struct storage<Level, Policy> {
+            using type = typename Policy::storage;
+            using reference = typename type::reference;
+            using const_reference = typename type::const_reference;
+        };
+    }
+
+    // If Capacity is not 0, the capacity of the book is a compile time constant and the book must be
+    // constructed from "data" of the same size, see also static_book below
+    template <typename Level, typename Policy = Level, typename Index = uint8_t, int Capacity = 0>
     struct book {
         // Actual level type, pulled from template parameters
         using level = typename std::remove_cv<typename std::remove_reference<Level>::type>::type;
+        using policy = Policy;
 
         // This class is non-assignable
         book& operator=(const book& ) = delete;
@@ -30,22 +57,161 @@ namespace market {
             { }
         };
 
-        // This structure can store at most 127 levels on each side, i.e. 254 in total
-        // Books which require larger depth will have to use a different data type
-        using size_type = uint8_t;
-        constexpr static size_type npos = 255;
-        static_assert(npos == (size_type)(-1));
+        // With the default Index type, this structure can store at most 127 levels on each side, i.e.
+        // 254 in total. Books which require larger depth can use uint16_t, for up to 32767 levels on
+        // each side, at the cost of twice the size of "sides" and "freel" arrays.
+        static_assert(std::is_same_v<Index, uint8_t> || std::is_same_v<Index, uint16_t>);
+        using size_type = Index;
+        constexpr static size_type npos = (size_type)(-1);
         static_assert((size_type)(npos + 1) == 0);
+        constexpr static int max_capacity = npos / 2;
+        static_assert(Capacity >= 0 && Capacity <= max_capacity);
+        // Largest side sorted with insertion sort by sort(), if more than one level is out of place
+        constexpr static size_type insertion_sort_max = 24;
+
+        // Policy can select linear search mode with "search_mode" member equal to search::linear. In
+        // this mode binary_search(), lower_bound(), upper_bound(), equal_range() and insert() scan an
+        // array of "keys" (see below), which is maintained by the book in the same order as "sides"
+        constexpr static bool linear = requires { requires Policy::search_mode == search::linear; };
+        using key_type = int32_t;
+
+        // Policy can select cumulative totals with member "cumulative" equal to true. In this mode the
+        // book maintains an array of "totals" in the same order as "sides", where element i holds the
+        // quantity and notional (i.e. the sum of price in ticks multiplied by quantity) of levels 0 to
+        // i inclusive, so depth(), within() and sweep() are O(log n). Policy must provide functions
+        // "quantity" and "tick" of a level. Totals are updated by all functions which change a side,
+        // from the first position changed, but NOT when the quantity of a level is changed via at(),
+        // which must be followed by recount().
+        constexpr static bool cumulative = requires { requires Policy::cumulative; };
+
+        struct total_type {
+            std::int64_t quantity = 0;
+            std::int64_t notional = 0;
+        };
+
+        // Result of sweep()
+        struct fill {
+            size_type last = npos; // Position of the deepest level reached, npos if none
+            std::int64_t quantity = 0; // Less than requested if all levels on the side were swept
+            std::int64_t notional = 0;
+
+            // Volume weighted average price in ticks, 0 if nothing was filled
+            constexpr double vwap() const noexcept {
+                return quantity == 0 ? 0.0 : (double)notional / (double)quantity;
+            }
+        };
+
+        // Policy can select structure of arrays mode with member type "storage", a small handle
+        // (e.g. a set of pointers) to separate arrays for the fields of levels, such as ticks[] and
+        // size[]. Its operator[] (const) must return member type "reference", a proxy which can be
+        // assigned from a level and converted to a level and to member type "const_reference". In
+        // this mode "levels" is a storage handle rather than a pointer, Policy functions (e.g.
+        // "compare") take proxies and can read only the fields they need, e.g. price, and functions
+        // which need the address of a level (top(), class "data" and constructor of immutable books)
+        // are not available. The arrays must be owned by the derived class.
+        constexpr static bool columns = requires { typename Policy::storage; };
+
+        // Policy can select instrumentation with member "instrumented" equal to true, in which case
+        // the book counts events (comparisons, bytes shifted, free list operations, levels rejected
+        // because a side is full, searches and sorts), see stats(). Independently, Policy can provide
+        // function "note", called as note<Event>(book, n) for every event. Neither costs anything
+        // if not provided by the Policy.
+        constexpr static bool instrumented = requires { requires Policy::instrumented; };
+        using storage_type = typename impl::storage<level, Policy>::type;
+        using reference = typename impl::storage<level, Policy>::reference;
+        using const_reference = typename impl::storage<level, Policy>::const_reference;
+
+        // Random access iterator over levels on one side of the book, in the order of "sides" (i.e.
+        // the same as at()). Holds "levels" and a pointer to the position in "sides", so the offset
+        // of the side is computed only once, in begin() or end(). Invalidated by any function which
+        // changes the size or order of the side, same as references returned by at().
+        template <bool Const>
+        class basic_iterator {
+            storage_type levels_ = {};
+            const size_type* pos_ = nullptr;
+
+            friend struct book;
+            friend class basic_iterator<not Const>;
+
+            constexpr basic_iterator(storage_type l, const size_type* p) noexcept : levels_(l), pos_(p) {}
+
+        public:
+            using iterator_concept = std::random_access_iterator_tag;
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = level;
+            using difference_type = std::ptrdiff_t;
+            using pointer = std::conditional_t<columns, void, std::conditional_t<Const, const level*, level*>>;
+            using reference = std::conditional_t<Const, book::const_reference, book::reference>;
+
+            constexpr basic_iterator() noexcept = default;
+
+            // Mutable iterator is convertible to const
+            template <bool Other> requires (Const && not Other)
+            constexpr basic_iterator(const basic_iterator<Other>& o) noexcept : levels_(o.levels_), pos_(o.pos_) {}
+
+            constexpr reference operator*() const noexcept { return levels_[*pos_]; }
+            constexpr pointer operator->() const noexcept requires (not columns) { return &levels_[*pos_]; }
+            constexpr reference operator[](difference_type n) const noexcept { return levels_[pos_[n]]; }
+
+            constexpr basic_iterator& operator++() noexcept { ++pos_; return *this; }
+            constexpr basic_iterator& operator--() noexcept { --pos_; return *this; }
+            constexpr basic_iterator operator++(int) noexcept { auto t = *this; ++pos_; return t; }
+            constexpr basic_iterator operator--(int) noexcept { auto t = *this; --pos_; return t; }
+            constexpr basic_iterator& operator+=(difference_type n) noexcept { pos_ += n; return *this; }
+            constexpr basic_iterator& operator-=(difference_type n) noexcept { pos_ -= n; return *this; }
+
+            friend constexpr basic_iterator operator+(basic_iterator i, difference_type n) noexcept {
+                return i += n;
+            }
+            friend constexpr basic_iterator operator+(difference_type n, basic_iterator i) noexcept {
+                return i += n;
+            }
+            friend constexpr basic_iterator operator-(basic_iterator i, difference_type n) noexcept {
+                return i -= n;
+            }
+            friend constexpr difference_type operator-(const basic_iterator& lh, const basic_iterator& rh) noexcept {
+                return lh.pos_ - rh.pos_;
+            }
+            friend constexpr bool operator==(const basic_iterator& lh, const basic_iterator& rh) noexcept {
+                return lh.pos_ == rh.pos_;
+            }
+            friend constexpr std::strong_ordering operator<=>(const basic_iterator& lh, const basic_iterator& rh) noexcept {
+                return lh.pos_ <=> rh.pos_;
+            }
+        };
+
+        using iterator = basic_iterator<false>;
+        using const_iterator = basic_iterator<true>;
+        static_assert(std::random_access_iterator<iterator> && std::random_access_iterator<const_iterator>);
 
     private:
         // Functions sort() and binary_search() require "compare", which must be provided by the
         // Policy. The function must return true if level lh is closer to the top of the book than
         // level rh (on the given Side)
         template <side Side, typename Lh, typename Rh>
-        static constexpr bool compare(Lh&& lh, Rh&& rh) noexcept {
+        constexpr bool compare(Lh&& lh, Rh&& rh) const noexcept {
+            note_<metric::compare>();
             return Policy::template compare<Side>(std::forward<Lh>(lh), std::forward<Rh>(rh));
         }
 
+        // Report n events, if Policy is instrumented or provides function "note"
+        template <metric Event>
+        constexpr void note_(std::uint64_t n = 1) const noexcept {
+            if constexpr (instrumented) {
+                stats_.add(Event, n);
+            }
+            if constexpr (requires { Policy::template note<Event>(*this, n); }) {
+                Policy::template note<Event>(*this, n);
+            }
+        }
+
+        // Same as common::shift, also counting bytes moved
+        template <typename Type>
+        constexpr void shift_(Type* dst, const Type* src, std::size_t n) noexcept {
+            note_<metric::shift>(n * sizeof(Type));
+            common::shift(dst, src, n);
+        }
+
         // Function binary_search() requires "make", which must be provided by the Policy. The
         // function must create a Level object (or suitable proxy) which will be used for comparison
         // when performing search
@@ -54,8 +220,119 @@ namespace market {
             return Policy::make(std::forward<Args>(a)...);
         }
 
+        // In linear search mode, function "key" must be provided by the Policy. The function must
+        // return an integer key of a level (and of the result of "make") such that level lh compares
+        // closer to the top of the book than level rh (on the given Side) if and only if the key of
+        // lh is smaller than the key of rh. Keys must fit in int32_t, e.g. price in ticks.
+        template <side Side, typename Value>
+        static constexpr key_type key(const Value& v) noexcept {
+            return (key_type)Policy::template key<Side>(v);
+        }
+
+        struct no_keys { };
+        struct no_totals { };
+        struct no_stats { };
+
+        // Capacity of each side and size of all arrays, folded to constants if Capacity is not 0
+        constexpr size_type cap_() const noexcept {
+            if constexpr (Capacity != 0) {
+                return (size_type)Capacity;
+            } else {
+                return capacity;
+            }
+        }
+
+        constexpr size_type total_() const noexcept {
+            return (size_type)(cap_() * 2);
+        }
+
+        // Store keys of levels on the given Side, starting from position i, in "keys" array
+        template <side Side>
+        constexpr void mirror_(size_type i) {
+            if constexpr (linear) {
+                const auto* const begin = &sides[(size_t)Side * cap_()];
+                auto* const k = &keys[(size_t)Side * cap_()];
+                for (size_type j = i; j < side_i[(size_t)Side]; ++j) {
+                    k[j] = book::key<Side>(levels[begin[j]]);
+                }
+            }
+            accumulate_<Side>(i);
+        }
+
+        // Quantity and notional of a single level
+        template <typename Value>
+        static constexpr total_type total_of_(const Value& l) noexcept {
+            const auto q = (std::int64_t)Policy::quantity(l);
+            return {q, q * (std::int64_t)Policy::tick(l)};
+        }
+
+        // Recompute "totals" of levels on the given Side, in positions from i to end (or to the end
+        // of the side, if npos)
+        template <side Side>
+        constexpr void accumulate_(size_type i, size_type end = npos) {
+            if constexpr (cumulative) {
+                const auto* const begin = &sides[(size_t)Side * cap_()];
+                auto* const t = &totals[(size_t)Side * cap_()];
+                auto sum = i == 0 ? total_type{} : t[i - 1];
+                end = end == npos ? side_i[(size_t)Side] : end;
+                for (; i < end; ++i) {
+                    const auto v = total_of_(levels[begin[i]]);
+                    sum.quantity += v.quantity;
+                    sum.notional += v.notional;
+                    t[i] = sum;
+                }
+            }
+        }
+
+        // Store in "totals" on the given Side, in positions j from i to end - 1, the totals from position
+        // j - offset plus delta, i.e. shift totals by offset (one of -1, 0, 1) and adjust them. Unlike
+        // accumulate_(), does not read levels, so the loop is over a contiguous array only.
+        template <side Side>
+        constexpr void adjust_(size_type i, size_type end, int offset, total_type delta) {
+            auto* const t = &totals[(size_t)Side * cap_()];
+            if (offset > 0) {
+                for (auto j = end; j > i; --j) {
+                    t[j - 1] = {t[j - 1 - offset].quantity + delta.quantity,
+                                t[j - 1 - offset].notional + delta.notional};
+                }
+            } else {
+                for (auto j = i; j < end; ++j) {
+                    t[j] = {t[j - offset].quantity + delta.quantity, t[j - offset].notional + delta.notional};
+                }
+            }
+        }
+
+        // Count keys on the given Side which are smaller than k (or, if Equal, not greater than k).
+        // Because keys are sorted, this is the position of lower bound (or upper bound) of k.
+        template <side Side, bool Equal>
+        constexpr size_type count_(key_type k) const {
+            const auto* const begin = &keys[(size_t)Side * cap_()];
+            const size_type size = side_i[(size_t)Side];
+            size_type i = 0;
+#if defined(__AVX2__)
+            if (not std::is_constant_evaluated()) {
+                const auto v = _mm256_set1_epi32(k);
+                for (; i + 8 <= size; i += 8) {
+                    const auto x = _mm256_loadu_si256((const __m256i*)(begin + i));
+                    // Bits set in the mask of matching keys must be contiguous, since keys are sorted
+                    const unsigned m = Equal
+                            ? ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(x, v))) & 0xff
+                            : _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(v, x)));
+                    if (m != 0xff) {
+                        note_<metric::compare>(i + 8);
+                        return i + (size_type)std::popcount(m);
+                    }
+                }
+            }
+#endif
+            for (; i < size && (Equal ? begin[i] <= k : begin[i] < k); ++i) {
+            }
+            note_<metric::compare>(i < size ? i + 1 : i);
+            return i;
+        }
+
         template <side Side, typename Value>
-        size_type upper_bound_(const size_type* begin,
+        constexpr size_type upper_bound_(const size_type* begin,
                                const size_type* from,
                                const size_type* end,
                                const Value& val
@@ -76,7 +353,7 @@ namespace market {
         }
 
         template <side Side, typename Value>
-        size_type lower_bound_(const size_type* begin,
+        constexpr size_type lower_bound_(const size_type* begin,
                                const size_type* from,
                                const size_type* end,
                                const Value& val
@@ -96,9 +373,103 @@ namespace market {
             return ret;
         }
 
+        // First position in range [from, end) with level which is not closer to the top of the book
+        // than v (if Upper, which is further from the top than v)
+        template <side Side, bool Upper, typename Value>
+        constexpr const size_type* bound_(const size_type* from, const size_type* end, const Value& v) const {
+            for (; from != end;) {
+                const auto* mid = from + ((end - from) / 2);
+                if (Upper ? not book::compare<Side>(v, levels[*mid]) : book::compare<Side>(levels[*mid], v)) {
+                    from = mid + 1;
+                } else {
+                    end = mid;
+                }
+            }
+            return from;
+        }
+
+        // Move index at position i on the given Side to the position where it belongs, assuming that
+        // the side is sorted without it. Does not update keys, returns the new position.
+        template <side Side>
+        constexpr size_type move_(size_type i) {
+            auto* const begin = &sides[(size_t)Side * cap_()];
+            const size_type size = side_i[(size_t)Side];
+            const auto l = begin[i];
+            size_type j = i;
+            if (i > 0 && book::compare<Side>(levels[l], levels[begin[i - 1]])) {
+                j = (size_type)(bound_<Side, true>(begin, begin + i, levels[l]) - begin);
+                shift_(begin + j + 1, begin + j, i - j);
+            } else if (i + 1 < size && not book::compare<Side>(levels[l], levels[begin[i + 1]])) {
+                j = (size_type)(bound_<Side, true>(begin + i + 1, begin + size, levels[l]) - begin) - 1;
+                shift_(begin + i, begin + i + 1, j - i);
+            }
+            begin[j] = l;
+            return j;
+        }
+
+        // Construct level at index l in "levels", also in constant evaluation
+        template <typename ... Args>
+        constexpr void construct_(size_type l, Args&& ... a) {
+            if constexpr (columns) {
+                levels[l] = level(std::forward<Args>(a)...);
+            } else if (std::is_constant_evaluated()) {
+                std::construct_at(&levels[l], std::forward<Args>(a)...);
+            } else {
+                common::emplace(&levels[l], std::forward<Args>(a) ...);
+            }
+        }
+
+        // Find the position for already allocated level l, shift the following indices by one and
+        // store l in the position found. Used by insert() and emplace()
+        template <side Side>
+        constexpr size_type place_(size_type l) {
+            auto& size = side_i[(size_t)Side];
+            auto* const begin = &sides[(size_t)Side * cap_()];
+            size_type i = 0;
+            if constexpr (linear) {
+                const auto k = book::key<Side>(levels[l]);
+                i = count_<Side, true>(k);
+                auto* const kb = &keys[(size_t)Side * cap_()];
+                shift_(kb + i + 1, kb + i, size - i);
+                kb[i] = k;
+            } else {
+                i = upper_bound_<Side>(begin, begin, begin + size, levels[l]);
+                if (i == npos) {
+                    i = size;
+                }
+            }
+            shift_(begin + i + 1, begin + i, size - i);
+            begin[i] = l;
+            ++size;
+            if constexpr (cumulative) {
+                auto* const t = &totals[(size_t)Side * cap_()];
+                const auto v = total_of_(levels[l]);
+                adjust_<Side>(i + 1, size, 1, v);
+                const auto prev = i == 0 ? total_type{} : t[i - 1];
+                t[i] = {prev.quantity + v.quantity, prev.notional + v.notional};
+            }
+            return i;
+        }
+
+        // Update cached top of the book on the given Side, after an operation which might have changed
+        // it. If the index of the top level did change, or the caller knows that the top level was
+        // changed (e.g. its slot was freed and reused), increment generation and, if Policy provides
+        // "top_changed", call it.
+        template <side Side>
+        constexpr void touch_(bool changed = false) {
+            const size_type t = side_i[(size_t)Side] == 0 ? npos : sides[(size_t)Side * cap_()];
+            if (changed || t != top_i[(size_t)Side]) {
+                top_i[(size_t)Side] = t;
+                ++generation_;
+                if constexpr (requires { Policy::template top_changed<Side>(*this); }) {
+                    Policy::template top_changed<Side>(*this);
+                }
+            }
+        }
+
     protected:
         // Size of "levels" "sides" and "freel" arrays must NOT be smaller than "capacity * 2"
-        level*          levels; // Array where levels are stored
+        storage_type    levels; // Array where levels are stored, or handle to arrays of their fields
         size_type*      sides; // Array of indices in levels, first half bids and second asks
         size_type*      freel; // Free list, i.e. all unallocated indices in levels
         const size_type size_i; // Size of all above arrays, i.e. capacity * 2
@@ -108,8 +479,26 @@ namespace market {
         // The memory for the three arrays "levels" "sides" and "freel" must be owned and maintained
         // by the derived class.
 
+        // Only in linear search mode, array of keys of levels in the same order as "sides". Its size
+        // must NOT be smaller than "capacity * 2". The memory must be owned by the derived class,
+        // which must also set this pointer unless class "data" is used.
+        [[no_unique_address]] std::conditional_t<linear, key_type*, no_keys> keys = {};
+
+        // Only in cumulative mode, array of totals in the same order as "sides". Same requirements
+        // as for "keys" above.
+        [[no_unique_address]] std::conditional_t<cumulative, total_type*, no_totals> totals = {};
+
+        // Only if instrumented, counters of events
+        [[no_unique_address]] mutable std::conditional_t<instrumented, counters, no_stats> stats_ = {};
+
+        // Index in levels of the top level on each side (or npos if the side is empty), and the
+        // number of changes of either. Maintained by all functions of this class which modify the
+        // sides, but NOT if the derived class modifies the arrays directly (unless it calls accept)
+        size_type       top_i[2] = {npos, npos};
+        std::uint32_t   generation_ = 0;
+
         // Safe to initialise "capacity" to 0, even though not very useful
-        book(level* l, size_type* s, size_type* f, int d, size_type b, size_type a)
+        book(storage_type l, size_type* s, size_type* f, int d, size_type b, size_type a) requires (Capacity == 0)
             : levels(l)
             , sides(s)
             , freel(f)
@@ -117,7 +506,7 @@ namespace market {
             , tail_i(size_i - (size_type)1 - b - a) // Note: will be npos if no space left
             , side_i{b, a}
             , capacity((size_type)d) {
-            if (d < 0 || d > 127) {
+            if (d < 0 || d > max_capacity) {
                 throw bad_capacity(d);
             }
         }
@@ -127,37 +516,46 @@ namespace market {
         constexpr static nothrow_t nothrow{};
 
         // Safe to use "capacity" = 0, and just useful enough to report that the container is useless
-        constexpr book(level* l, size_type* s, size_type* f, int d, size_type b, size_type a, const nothrow_t)
+        constexpr book(storage_type l, size_type* s, size_type* f, int d, size_type b, size_type a, const nothrow_t)
+            requires (Capacity == 0)
             : levels(l)
             , sides(s)
             , freel(f)
             , size_i((size_type)(d * 2))
             , tail_i(size_i - (size_type)1 - b - a)
             , side_i{b, a}
-            , capacity((d < 0 || d > 127) ? 0 : (size_type)d)
+            , capacity((d < 0 || d > max_capacity) ? 0 : (size_type)d)
         { }
 
-        // Can be used to construct immutable books (also 0 capacity)
+        // Can be used to construct immutable books (also 0 capacity). If Capacity is not 0, then "d"
+        // must be equal to it
         constexpr book(const level* l, const size_type* s, int d, size_type b, size_type a, const nothrow_t)
+                requires (not columns)
                 : levels(const_cast<level*>(l))
                 , sides(const_cast<size_type*>(s))
                 , freel(nullptr) // see tail_i(npos) below
                 , size_i((size_type)(d * 2))
                 , tail_i(npos)
                 , side_i{b, a}
-                , capacity((d < 0 || d > 127) ? 0 : (size_type)d)
-        { }
+                , capacity((d < 0 || d > max_capacity) ? 0 : (size_type)d) {
+            // Immutable book cannot be modified, so the cached top is only set here
+            top_i[0] = (b == 0 || capacity == 0) ? npos : sides[0];
+            top_i[1] = (a == 0 || capacity == 0) ? npos : sides[cap_()];
+        }
 
         // Class "data" does not have to be used, but it helps. Obviously it cannot
         // be used when capacity is determined in runtime (or is 0), in which case the
         // derived class has to take care of memory management for both tables.
         template <int Size>
         struct data {
-            static_assert(Size > 0 && Size <= 127);
+            static_assert(Size > 0 && Size <= max_capacity && (Capacity == 0 || Size == Capacity));
+            static_assert(not columns, "structure of arrays storage must be owned by the derived class");
             constexpr static size_type capacity = (size_type)Size;
             level levels[Size * 2] = {};
             size_type sides[Size * 2] = {};
             size_type freel[Size * 2] = {};
+            [[no_unique_address]] std::conditional_t<linear, key_type[Size * 2], no_keys> keys = {};
+            [[no_unique_address]] std::conditional_t<cumulative, total_type[Size * 2], no_totals> totals = {};
         };
 
         template <int Size>
@@ -168,8 +566,14 @@ namespace market {
             , size_i(p.capacity * (size_type)2)
             , tail_i(size_i - (size_type)1 - b - a)
             , side_i{b, a}
-            , capacity(p.capacity)
-        { }
+            , capacity(p.capacity) {
+            if constexpr (linear) {
+                keys = p.keys;
+            }
+            if constexpr (cumulative) {
+                totals = p.totals;
+            }
+        }
 
         template <int Size>
         constexpr explicit book(const data<Size>& p, size_type b, size_type a)
@@ -179,24 +583,32 @@ namespace market {
                 , size_i(p.capacity * (size_type)2)
                 , tail_i(size_i - (size_type)1 - b - a)
                 , side_i{b, a}
-                , capacity(p.capacity)
-        { }
+                , capacity(p.capacity) {
+            if constexpr (linear) {
+                keys = const_cast<key_type*>(p.keys);
+            }
+            if constexpr (cumulative) {
+                totals = const_cast<total_type*>(p.totals);
+            }
+        }
 
         // If freel is not populated to match tail_i, the derived class must call either of the
         // initialisation functions reset() or accept() to populate it.
-        void reset() {
+        constexpr void reset() {
             ASSERT(freel != nullptr);
             size_type i = 0;
-            for (; i < size_i; ++i) {
+            for (; i < total_(); ++i) {
                 freel[i] = i;
             }
-            tail_i = size_i - 1;
+            tail_i = total_() - 1;
             side_i[0] = side_i[1] = 0;
+            touch_<side::bid>();
+            touch_<side::ask>();
         };
 
-        void accept() {
+        constexpr void accept() {
             ASSERT(freel != nullptr);
-            for (size_type i = 0; i < size_i; ++i) {
+            for (size_type i = 0; i < total_(); ++i) {
                 freel[i] = i;
             }
             // Mark elements in the free list, which are not actually free, with npos
@@ -205,109 +617,460 @@ namespace market {
                     freel[sides[i]] = npos;
                 }
                 if (i < side_i[1]) {
-                    freel[sides[capacity + i]] = npos;
+                    freel[sides[cap_() + i]] = npos;
                 }
             }
             // Note: tail_i will underflow to npos if no space left, by design
-            tail_i = size_i - (size_type)1 - side_i[0] - side_i[1];
+            tail_i = total_() - (size_type)1 - side_i[0] - side_i[1];
             // Shift freel elements marked as taken (i.e. with npos value) to the end of freel
             // Note: npos will not be preserved, it has no special meaning outside of accept
             auto* const begin = &freel[0];
-            std::remove_if(begin, begin + size_i, [](size_type n){ return n == npos; } );
+            std::remove_if(begin, begin + total_(), [](size_type n){ return n == npos; } );
+            mirror_<side::bid>(0);
+            mirror_<side::ask>(0);
+            touch_<side::bid>();
+            touch_<side::ask>();
         };
 
     public:
         const size_type capacity;
 
         template <side Side, typename Type>
-        size_type push_back(Type&& a) {
+        constexpr size_type push_back(Type&& a) {
             ASSERT(freel != nullptr);
-            ASSERT(side_i[0] + side_i[1] + (size_type)(tail_i + 1) == size_i);
+            ASSERT(side_i[0] + side_i[1] + (size_type)(tail_i + 1) == total_());
             size_type result = npos;
             auto& size = side_i[(size_t)Side];
-            if (size < capacity) {
+            if (size < cap_()) {
                 ASSERT(tail_i != npos);
                 // Note: must post-decrement tail_i here. Will change to npos if it was 0
                 const auto l = freel[tail_i--];
+                note_<metric::pop>();
                 levels[l] = std::forward<Type>(a);
-                sides[(size_t)Side * capacity + size] = l;
+                sides[(size_t)Side * cap_() + size] = l;
                 result = size++; // Note: must post-increment side_i[Side] here
+                mirror_<Side>(result);
+                if (result == 0) {
+                    touch_<Side>();
+                }
+            } else {
+                note_<metric::reject>();
             }
             return result;
         }
 
         template <side Side, typename ... Args>
-        size_type emplace_back(Args&& ... a) {
+        constexpr size_type emplace_back(Args&& ... a) {
             ASSERT(freel != nullptr);
-            ASSERT(side_i[0] + side_i[1] + (size_type)(tail_i + 1) == size_i);
+            ASSERT(side_i[0] + side_i[1] + (size_type)(tail_i + 1) == total_());
             size_type result = npos;
             auto& size = side_i[(size_t)Side];
-            if (size < capacity) {
+            if (size < cap_()) {
                 ASSERT(tail_i != npos);
                 // Note: must post-decrement tail_i here. Will change to npos if it was 0
                 const auto l = freel[tail_i--];
-                common::emplace(&levels[l], std::forward<Args>(a) ...);
-                sides[(size_t)Side * capacity + size] = l;
+                note_<metric::pop>();
+                construct_(l, std::forward<Args>(a) ...);
+                sides[(size_t)Side * cap_() + size] = l;
                 result = size++; // Note: must post-increment side_i[Side] here
+                mirror_<Side>(result);
+                if (result == 0) {
+                    touch_<Side>();
+                }
+            } else {
+                note_<metric::reject>();
+            }
+            return result;
+        }
+
+        // Insert level on the given Side, in the position determined by Policy "compare", after any
+        // levels which compare equal. Returns the final position or npos if this side is full. Note,
+        // the side is expected to be already sorted, otherwise the position is unspecified.
+        template <side Side, typename Type>
+        constexpr size_type insert(Type&& a) {
+            ASSERT(freel != nullptr);
+            ASSERT(side_i[0] + side_i[1] + (size_type)(tail_i + 1) == total_());
+            size_type result = npos;
+            if (side_i[(size_t)Side] < cap_()) {
+                ASSERT(tail_i != npos);
+                // Note: must post-decrement tail_i here. Will change to npos if it was 0
+                const auto l = freel[tail_i--];
+                note_<metric::pop>();
+                levels[l] = std::forward<Type>(a);
+                result = place_<Side>(l);
+                if (result == 0) {
+                    touch_<Side>();
+                }
+            } else {
+                note_<metric::reject>();
+            }
+            return result;
+        }
+
+        template <side Side, typename ... Args>
+        constexpr size_type emplace(Args&& ... a) {
+            ASSERT(freel != nullptr);
+            ASSERT(side_i[0] + side_i[1] + (size_type)(tail_i + 1) == total_());
+            size_type result = npos;
+            if (side_i[(size_t)Side] < cap_()) {
+                ASSERT(tail_i != npos);
+                // Note: must post-decrement tail_i here. Will change to npos if it was 0
+                const auto l = freel[tail_i--];
+                note_<metric::pop>();
+                construct_(l, std::forward<Args>(a) ...);
+                result = place_<Side>(l);
+                if (result == 0) {
+                    touch_<Side>();
+                }
+            } else {
+                note_<metric::reject>();
             }
             return result;
         }
 
         template <side Side>
-        void remove(size_type i) {
+        constexpr void remove(size_type i) {
             ASSERT(freel != nullptr);
             ASSERT(i < side_i[(size_t)Side]);
-            ASSERT(side_i[0] + side_i[1] + (size_type)(tail_i + 1) == size_i);
-            const auto l = sides[(size_t)Side * capacity + i];
+            ASSERT(side_i[0] + side_i[1] + (size_type)(tail_i + 1) == total_());
+            const auto l = sides[(size_t)Side * cap_() + i];
             freel[++tail_i] = l; // Note: must pre-increment tail_l here
-            const auto size = (side_i[(size_t)Side])--; // Note: must post-decrement side[Side]
-            for (size_type j = i; j < size;) {
-                auto& n = sides[(size_t)Side * capacity + j];
-                n = sides[(size_t)Side * capacity + ++j]; // Note: must pre-increment j here
+            note_<metric::push>();
+            const auto size = --(side_i[(size_t)Side]); // Note: must pre-decrement side[Side]
+            auto* const begin = &sides[(size_t)Side * cap_()];
+            shift_(begin + i, begin + i + 1, size - i);
+            if constexpr (linear) {
+                auto* const k = &keys[(size_t)Side * cap_()];
+                shift_(k + i, k + i + 1, size - i);
+            }
+            if constexpr (cumulative) {
+                const auto* const t = &totals[(size_t)Side * cap_()];
+                const auto prev = i == 0 ? total_type{} : t[i - 1];
+                adjust_<Side>(i, size, -1, {prev.quantity - t[i].quantity, prev.notional - t[i].notional});
+            }
+            if (i == 0) {
+                touch_<Side>();
             }
         }
 
+        // Apply a batch of operations (e.g. all updates of one side from a single exchange packet) to
+        // the given Side, which must be sorted. Type Op must provide members "what" (of type action)
+        // and "level"; update and erase refer to the first level which compares equal to "level", as
+        // in find(). The batch is sorted in place, and then merged with the side in a single pass,
+        // i.e. O(n + k log k) for n levels and k operations. Operations on levels which compare equal
+        // are applied in the order: erase, update, insert. Operations which cannot be applied are
+        // skipped, i.e. update or erase of a missing level, or insert into a full side (in which case
+        // the deepest levels are skipped). Returns the number of operations applied.
+        template <side Side, typename Op>
+        constexpr std::size_t apply_batch(std::span<Op> ops) {
+            ASSERT(freel != nullptr);
+            ASSERT(side_i[0] + side_i[1] + (size_type)(tail_i + 1) == total_());
+            std::sort(ops.begin(), ops.end(), [this](const Op& lh, const Op& rh) {
+                if (book::compare<Side>(lh.level, rh.level)) {
+                    return true;
+                } else if (book::compare<Side>(rh.level, lh.level)) {
+                    return false;
+                }
+                return (int)lh.what > (int)rh.what;
+            });
+
+            // First pass removes erased levels, compacting the side in place, and updates levels. Note,
+            // levels between operations are moved in blocks, which is much faster than one by one
+            auto& size = side_i[(size_t)Side];
+            auto* const begin = &sides[(size_t)Side * cap_()];
+            std::size_t applied = 0;
+            std::size_t inserts = 0;
+            size_type i = 0;
+            size_type w = 0;
+            // Set if the top level was erased, updated or inserted. Cannot be detected by touch_() from
+            // the index of the top level alone, since an erased slot can be reused by an insert
+            bool top = false;
+            for (const auto& o : ops) {
+                if (o.what == action::insert) {
+                    ++inserts;
+                    continue;
+                }
+                // Move the levels preceding o, which are kept, in a single block
+                const auto p = (size_type)(bound_<Side, false>(begin + i, begin + size, o.level) - begin);
+                if (w != i) {
+                    shift_(begin + w, begin + i, p - i);
+                }
+                w += p - i;
+                i = p;
+                if (i == size || book::compare<Side>(o.level, levels[begin[i]])) {
+                    continue; // Not found
+                }
+                top = top || i == 0;
+                if (o.what == action::update) {
+                    levels[begin[i]] = o.level;
+                } else {
+                    freel[++tail_i] = begin[i++]; // Note: must pre-increment tail_i here
+                    note_<metric::push>();
+                }
+                ++applied;
+            }
+            if (w != i) {
+                shift_(begin + w, begin + i, size - i);
+            }
+            w += size - i;
+
+            // Second pass merges inserted levels, starting from the end of the side
+            const auto room = (std::size_t)(cap_() - w);
+            const auto m = (size_type)(inserts < room ? inserts : room);
+            auto skip = inserts - m;
+            note_<metric::reject>(skip);
+            size_type out = w + m;
+            size_type e = w;
+            for (auto j = ops.size(); j-- > 0 && out > e;) {
+                const auto& o = ops[j];
+                if (o.what != action::insert) {
+                    continue;
+                } else if (skip > 0) {
+                    --skip;
+                    continue;
+                }
+                ASSERT(tail_i != npos);
+                const auto l = freel[tail_i--]; // Note: must post-decrement tail_i here
+                note_<metric::pop>();
+                levels[l] = o.level;
+                // Inserted level is placed after levels which compare equal
+                const auto q = (size_type)(bound_<Side, true>(begin, begin + e, o.level) - begin);
+                out -= e - q;
+                shift_(begin + out, begin + q, e - q);
+                e = q;
+                begin[--out] = l;
+                top = top || out == 0;
+            }
+            size = w + m;
+            mirror_<Side>(0);
+            touch_<Side>(top);
+            return applied + m;
+        }
+
         template <side Side>
-        size_type size() const {
+        constexpr size_type size() const {
             return side_i[(size_t)Side];
         }
 
+        // Sort levels on the given Side, e.g. after the price of some levels was changed. Adapts to
+        // the disorder found: an already sorted side is left as is, a single displaced level is moved
+        // to its position (as in resort_one()) and small sides use insertion sort.
         template <side Side>
-        void sort() {
-            auto* const begin = &sides[(size_t)Side * capacity];
-            std::sort(begin, begin + side_i[(size_t)Side], [this](size_type lh, size_type rh){
+        constexpr void sort() {
+            note_<metric::sort>();
+            auto* const begin = &sides[(size_t)Side * cap_()];
+            const size_type size = side_i[(size_t)Side];
+            auto less = [this](size_type lh, size_type rh) {
                 return book::compare<Side>(levels[lh], levels[rh]);
+            };
+            size_type descents = 0, d = 0;
+            for (size_type i = 1; i < size; ++i) {
+                if (less(begin[i], begin[i - 1])) {
+                    d = descents++ == 0 ? i : d;
+                }
+            }
+
+            if (descents == 0) {
+            } else if (descents == 1 && (d == 1 || not less(begin[d], begin[d - 2]))) {
+                // Sorted without level at d - 1, which must have moved further from the top
+                move_<Side>(d - 1);
+            } else if (descents == 1 && (d + 1 == size || not less(begin[d + 1], begin[d - 1]))) {
+                // Sorted without level at d, which must have moved closer to the top
+                move_<Side>(d);
+            } else if (size <= insertion_sort_max) {
+                // Levels before d are already sorted
+                for (size_type i = d; i < size; ++i) {
+                    const auto l = begin[i];
+                    size_type j = i;
+                    for (; j > 0 && less(l, begin[j - 1]); --j) {
+                        begin[j] = begin[j - 1];
+                    }
+                    begin[j] = l;
+                }
+            } else {
+                std::sort(begin, begin + size, less);
+            }
+            mirror_<Side>(0);
+            touch_<Side>();
+        }
+
+        // Move the level at position i on the given Side, e.g. after its price was changed, to the
+        // position where it belongs; the side must be otherwise sorted. Returns the new position.
+        // Levels which compare equal keep their order, and the moved level is placed after them.
+        template <side Side>
+        constexpr size_type resort_one(size_type i) {
+            ASSERT(i < side_i[(size_t)Side]);
+            const auto j = move_<Side>(i);
+            if constexpr (linear) {
+                auto* const k = &keys[(size_t)Side * cap_()];
+                if (j < i) {
+                    shift_(k + j + 1, k + j, i - j);
+                } else if (j > i) {
+                    shift_(k + i, k + i + 1, j - i);
+                }
+                k[j] = book::key<Side>(levels[sides[(size_t)Side * cap_() + j]]);
+            }
+            accumulate_<Side>(i < j ? i : j, (i < j ? j : i) + 1);
+            if (i == 0 || j == 0) {
+                touch_<Side>();
+            }
+            return j;
+        }
+
+        // Only in cumulative mode. Must be called after the quantity of the level at position i on the
+        // given Side was changed via at()
+        template <side Side>
+        constexpr void recount(size_type i) requires cumulative {
+            ASSERT(i < side_i[(size_t)Side]);
+            const auto* const t = &totals[(size_t)Side * cap_()];
+            const auto prev = i == 0 ? total_type{} : t[i - 1];
+            const auto v = total_of_(levels[sides[(size_t)Side * cap_() + i]]);
+            adjust_<Side>(i, side_i[(size_t)Side], 0, {v.quantity - (t[i].quantity - prev.quantity),
+                                                       v.notional - (t[i].notional - prev.notional)});
+        }
+
+        // Only in cumulative mode. Totals of n levels from the top on the given Side, O(1)
+        template <side Side>
+        constexpr total_type depth(size_type n) const requires cumulative {
+            ASSERT(n <= side_i[(size_t)Side]);
+            return n == 0 ? total_type{} : totals[(size_t)Side * cap_() + n - 1];
+        }
+
+        // Only in cumulative mode. Totals of levels on the given Side which are at most "distance"
+        // ticks away from the top level, O(log n). Requires "make" from a price in ticks.
+        template <side Side>
+        constexpr total_type within(std::int64_t distance) const requires cumulative {
+            const auto size = side_i[(size_t)Side];
+            if (size == 0) {
+                return {};
+            }
+            const auto top = (std::int64_t)Policy::tick(levels[sides[(size_t)Side * cap_()]]);
+            const auto limit = Side == side::bid ? top - distance : top + distance;
+            const auto i = upper_bound<Side>(limit);
+            return depth<Side>(i == npos ? size : i);
+        }
+
+        // Only in cumulative mode. Take "quantity" from the given Side, starting from the top, i.e.
+        // as an aggressive order would. Returns the position of the deepest level reached and the
+        // quantity and notional filled, O(log n). The book is not modified.
+        template <side Side>
+        constexpr fill sweep(std::int64_t quantity) const requires cumulative {
+            const auto size = side_i[(size_t)Side];
+            if (size == 0 || quantity <= 0) {
+                return {};
+            }
+            const auto* const t = &totals[(size_t)Side * cap_()];
+            const auto* const last = std::partition_point(t, t + size - 1, [quantity](const total_type& v) {
+                return v.quantity < quantity;
             });
+            const auto i = (size_type)(last - t);
+            const auto before = i == 0 ? total_type{} : t[i - 1];
+            const auto q = std::min(quantity, last->quantity) - before.quantity;
+            const auto& l = levels[sides[(size_t)Side * cap_() + i]];
+            return {i, before.quantity + q, before.notional + q * (std::int64_t)Policy::tick(l)};
         }
 
         template <side Side>
-        bool empty() const {
+        constexpr bool empty() const {
             return side_i[(size_t)Side] == 0;
         }
 
         template <side Side>
-        bool full() const {
-            return side_i[(size_t)Side] == capacity;
+        constexpr bool full() const {
+            return side_i[(size_t)Side] == cap_();
         }
 
         template <side Side>
-        const level& at(size_type i) const {
+        constexpr const_reference at(size_type i) const {
             ASSERT(i < side_i[(size_t)Side]);
-            const auto l = sides[(size_t)Side * capacity + i];
+            const auto l = sides[(size_t)Side * cap_() + i];
             return levels[l];
         }
 
         template <side Side>
-        level& at(size_type i) {
+        constexpr reference at(size_type i) {
             ASSERT(i < side_i[(size_t)Side]);
-            const auto l = sides[(size_t)Side * capacity + i];
+            const auto l = sides[(size_t)Side * cap_() + i];
             return levels[l];
         }
 
+        template <side Side>
+        constexpr iterator begin() noexcept {
+            return iterator(levels, &sides[(size_t)Side * cap_()]);
+        }
+
+        template <side Side>
+        constexpr iterator end() noexcept {
+            return iterator(levels, &sides[(size_t)Side * cap_() + side_i[(size_t)Side]]);
+        }
+
+        template <side Side>
+        constexpr const_iterator begin() const noexcept {
+            return const_iterator(levels, &sides[(size_t)Side * cap_()]);
+        }
+
+        template <side Side>
+        constexpr const_iterator end() const noexcept {
+            return const_iterator(levels, &sides[(size_t)Side * cap_() + side_i[(size_t)Side]]);
+        }
+
+        template <side Side>
+        constexpr const_iterator cbegin() const noexcept {
+            return begin<Side>();
+        }
+
+        template <side Side>
+        constexpr const_iterator cend() const noexcept {
+            return end<Side>();
+        }
+
+        // Levels on the given Side as a std::ranges view, e.g. for use with std::ranges algorithms
+        // or std::views adaptors. Invalidated in the same way as iterators.
+        template <side Side>
+        constexpr std::ranges::subrange<iterator> range() noexcept {
+            return {begin<Side>(), end<Side>()};
+        }
+
+        template <side Side>
+        constexpr std::ranges::subrange<const_iterator> range() const noexcept {
+            return {begin<Side>(), end<Side>()};
+        }
+
+        // Top level on the given Side, or nullptr if empty. Unlike at(0), does not read "sides"
+        template <side Side>
+        constexpr const level* top() const requires (not columns) {
+            const auto t = top_i[(size_t)Side];
+            return t == npos ? nullptr : &levels[t];
+        }
+
+        // Only if instrumented, counters of events since construction or the last clear_stats()
+        constexpr const counters& stats() const noexcept requires instrumented {
+            return stats_;
+        }
+
+        constexpr void clear_stats() noexcept requires instrumented {
+            stats_ = {};
+        }
+
+        // Incremented every time the top level on either side changes (i.e. is replaced by another
+        // level, or removed). Note, changes of the contents of a level (e.g. via at()) are not counted.
+        constexpr std::uint32_t generation() const {
+            return generation_;
+        }
+
         template <side Side, typename ... Args>
-        size_type binary_search(Args &&... a) const {
+        constexpr size_type binary_search(Args &&... a) const {
+            note_<metric::search>();
+            if constexpr (linear) {
+                const auto k = book::key<Side>(book::make(std::forward<Args>(a)...));
+                const auto i = count_<Side, false>(k);
+                if (i < side_i[(size_t)Side] && keys[(size_t)Side * cap_() + i] == k) {
+                    return i;
+                }
+                return npos;
+            }
             const auto& val = book::make(std::forward<Args>(a)...);
-            const auto* begin = &sides[(size_t)Side * capacity];
+            const auto* begin = &sides[(size_t)Side * cap_()];
             const auto size = side_i[(size_t)Side];
             const auto* end = begin + size;
             // Cannot use std::binary_search here, because that wouldn't have returned an index
@@ -328,25 +1091,43 @@ namespace market {
         }
 
         template <side Side, typename ... Args>
-        size_type lower_bound(Args&& ... a) const {
+        constexpr size_type lower_bound(Args&& ... a) const {
+            note_<metric::search>();
+            if constexpr (linear) {
+                const auto i = count_<Side, false>(book::key<Side>(book::make(std::forward<Args>(a)...)));
+                return i == side_i[(size_t)Side] ? npos : i;
+            }
             const auto& val = book::make(std::forward<Args>(a)...);
-            const auto* begin = &sides[(size_t)Side * capacity];
+            const auto* begin = &sides[(size_t)Side * cap_()];
             const auto* end = begin + side_i[(size_t)Side];
             return lower_bound_<Side>(begin, begin, end, val);
         }
 
         template <side Side, typename ... Args>
-        size_type upper_bound(Args&& ... a) const {
+        constexpr size_type upper_bound(Args&& ... a) const {
+            note_<metric::search>();
+            if constexpr (linear) {
+                const auto i = count_<Side, true>(book::key<Side>(book::make(std::forward<Args>(a)...)));
+                return i == side_i[(size_t)Side] ? npos : i;
+            }
             const auto& val = book::make(std::forward<Args>(a)...);
-            const auto* begin = &sides[(size_t)Side * capacity];
+            const auto* begin = &sides[(size_t)Side * cap_()];
             const auto* end = begin + side_i[(size_t)Side];
             return upper_bound_<Side>(begin, begin, end, val);
         }
 
         template <side Side, typename ... Args>
-        std::pair<size_type, size_type> equal_range(Args&& ... a) const {
+        constexpr std::pair<size_type, size_type> equal_range(Args&& ... a) const {
+            note_<metric::search>();
+            if constexpr (linear) {
+                const auto k = book::key<Side>(book::make(std::forward<Args>(a)...));
+                const auto size = side_i[(size_t)Side];
+                const auto l = count_<Side, false>(k);
+                const auto u = count_<Side, true>(k);
+                return std::make_pair(l == size ? npos : l, u == size ? npos : u);
+            }
             const auto& val = book::make(std::forward<Args>(a)...);
-            const auto* begin = &sides[(size_t)Side * capacity];
+            const auto* begin = &sides[(size_t)Side * cap_()];
             const auto* end = begin + side_i[(size_t)Side];
             const auto* from = begin;
             for (; from != end;) {
@@ -367,5 +1148,65 @@ namespace market {
             }
             return std::make_pair(r, r);
         }
+
+        // Position of the first level which compares equal to v (i.e. neither is closer to the top of
+        // the book than the other), or npos if not found. Unlike binary_search(), does not use "make"
+        template <side Side>
+        constexpr size_type find(const level& v) const {
+            note_<metric::search>();
+            const auto* begin = &sides[(size_t)Side * cap_()];
+            const auto size = side_i[(size_t)Side];
+            size_type i = 0;
+            if constexpr (linear) {
+                i = count_<Side, false>(book::key<Side>(v));
+            } else {
+                i = lower_bound_<Side>(begin, begin, begin + size, v);
+            }
+            if (i < size && not book::compare<Side>(v, levels[begin[i]])) {
+                return i;
+            }
+            return npos;
+        }
+    };
+
+    // Book with capacity N fixed at compile time, which owns its levels (as member "data"). Because
+    // "capacity" is a constant, the index arithmetic folds and short loops can be unrolled. All
+    // functions are constexpr, so a book can be built and verified during compilation, e.g. as a
+    // reference in tests. Unlike class book, this class can be copied (including stats, if
+    // instrumented).
+    template <typename Level, int N, typename Policy = Level>
+    struct static_book : book<Level, Policy, std::conditional_t<(N <= 127), std::uint8_t, std::uint16_t>, N> {
+        using base_type = book<Level, Policy, std::conditional_t<(N <= 127), std::uint8_t, std::uint16_t>, N>;
+        using typename base_type::size_type;
+        constexpr static size_type capacity = (size_type)N;
+
+        constexpr static_book() : base_type(data, 0, 0) {
+            base_type::reset();
+        }
+
+        constexpr static_book(const static_book& o) : base_type(data, 0, 0), data(o.data) {
+            copy_(o);
+        }
+
+        constexpr static_book& operator=(const static_book& o) {
+            data = o.data;
+            copy_(o);
+            return *this;
+        }
+
+        using base_type::reset;
+
+    private:
+        constexpr void copy_(const static_book& o) {
+            this->tail_i = o.tail_i;
+            this->side_i[0] = o.side_i[0];
+            this->side_i[1] = o.side_i[1];
+            this->top_i[0] = o.top_i[0];
+            this->top_i[1] = o.top_i[1];
+            this->generation_ = o.generation_;
+            this->stats_ = o.stats_;
+        }
+
+        typename base_type::template data<N> data;
     };
 } // namespace market
@@ -0,0 +1,178 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "book.hpp"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+namespace market {
+    // Consolidated view of books of the same instrument on several venues. Does not store any levels;
+    // instead, for each side it maintains a tournament (winner) tree over the top levels of all venues,
+    // so the best venue is known in O(1) and a change of top level on one venue is applied in
+    // O(log Venues), see update() and refresh(). Deeper levels are merged lazily by for_each(), which
+    // replays the tree on a copy, i.e. O(M log Venues) for the top M levels.
+    //
+    // Levels on different venues (or on the same venue) which compare equal are aggregated into a
+    // single level, with Policy function "combine", which must add the quantity of the second level
+    // to the first one.
+    template <typename Book, std::size_t Venues>
+    class consolidated {
+    public:
+        using book_type = Book;
+        using level = typename Book::level;
+        using size_type = typename Book::size_type;
+        using venues_type = std::uint64_t; // Bitmask of venues
+        constexpr static std::size_t npos = (std::size_t)(-1);
+        static_assert(Venues > 0 && Venues <= 64);
+
+    private:
+        using policy = typename Book::policy;
+
+        // Number of leaves of the tree, leaf of venue v is node "leaves + v", root is node 1
+        constexpr static std::size_t leaves = std::bit_ceil(Venues);
+        using tree = std::array<std::uint8_t, leaves * 2>;
+        constexpr static std::uint8_t none = (std::uint8_t)(-1);
+
+        // Current level of each venue on one side (nullptr if none left), compared by the tree, and
+        // its position, from which the lazy merge continues
+        struct cursors {
+            std::array<const level*, Venues> heads;
+            std::array<size_type, Venues> positions;
+        };
+
+        template <side Side>
+        const level* at_(std::size_t v, size_type i) const {
+            const auto* const b = books_[v];
+            return i < b->template size<Side>() ? &b->template at<Side>(i) : nullptr;
+        }
+
+        // Winner of two venues a and b (either of which can be none). Venue with the lower index wins
+        // if levels compare equal
+        template <side Side>
+        static std::uint8_t play_(std::uint8_t a, std::uint8_t b, const cursors& c) {
+            const auto* const la = a == none ? nullptr : c.heads[a];
+            const auto* const lb = b == none ? nullptr : c.heads[b];
+            if (la == nullptr || lb == nullptr) {
+                return la == nullptr ? (lb == nullptr ? none : b) : a;
+            }
+            return policy::template compare<Side>(*lb, *la) ? b : a;
+        }
+
+        // Replay matches on the path from the leaf of venue v to the root
+        template <side Side>
+        static void replay_(tree& t, std::size_t v, const cursors& c) {
+            for (auto n = (leaves + v) / 2; n > 0; n /= 2) {
+                t[n] = play_<Side>(t[n * 2], t[n * 2 + 1], c);
+            }
+        }
+
+        template <side Side>
+        void build_() {
+            auto& t = trees_[(std::size_t)Side];
+            auto& c = tops_[(std::size_t)Side];
+            for (std::size_t n = 0; n < leaves; ++n) {
+                t[leaves + n] = n < Venues ? (std::uint8_t)n : none;
+            }
+            for (std::size_t v = 0; v < Venues; ++v) {
+                c.heads[v] = at_<Side>(v, 0);
+            }
+            for (auto n = leaves - 1; n > 0; --n) {
+                t[n] = play_<Side>(t[n * 2], t[n * 2 + 1], c);
+            }
+        }
+
+        std::array<const Book*, Venues> books_;
+        std::array<std::uint32_t, Venues> generations_ = {};
+        tree trees_[2] = {};
+        cursors tops_[2] = {}; // Top level of each venue, positions are all 0
+
+    public:
+        // Books must remain valid for the lifetime of this object
+        explicit consolidated(const std::array<const Book*, Venues>& books) : books_(books) {
+            for (std::size_t v = 0; v < Venues; ++v) {
+                generations_[v] = books_[v]->generation();
+            }
+            build_<side::bid>();
+            build_<side::ask>();
+        }
+
+        const Book& book(std::size_t venue) const { return *books_[venue]; }
+
+        // Must be called when the top level on Side of the given venue was changed in a way which is
+        // not reflected by generation() of its book, e.g. its price was changed with at()
+        template <side Side>
+        void update(std::size_t venue) {
+            auto& c = tops_[(std::size_t)Side];
+            c.heads[venue] = at_<Side>(venue, 0);
+            replay_<Side>(trees_[(std::size_t)Side], venue, c);
+        }
+
+        // Update both sides of venues whose book generation() has changed, returns the number of
+        // such venues
+        std::size_t refresh() {
+            std::size_t result = 0;
+            for (std::size_t v = 0; v < Venues; ++v) {
+                const auto g = books_[v]->generation();
+                if (g != generations_[v]) {
+                    generations_[v] = g;
+                    update<side::bid>(v);
+                    update<side::ask>(v);
+                    ++result;
+                }
+            }
+            return result;
+        }
+
+        // Venue with the best top level on Side (the lowest index, if more than one), or npos if all
+        // books are empty on this side
+        template <side Side>
+        std::size_t best() const {
+            const auto w = trees_[(std::size_t)Side][1];
+            return w == none ? npos : (std::size_t)w;
+        }
+
+        // Best top level on Side, not aggregated with other venues, or nullptr
+        template <side Side>
+        const level* top() const {
+            const auto w = trees_[(std::size_t)Side][1];
+            return w == none ? nullptr : tops_[(std::size_t)Side].heads[w];
+        }
+
+        // Call fn(level, venues) for at most m top levels on Side, aggregated across venues, in order.
+        // Argument "venues" is a bitmask of venues where the level is present. Returns the number of
+        // levels visited.
+        template <side Side, typename Fn>
+        std::size_t for_each(std::size_t m, Fn&& fn) const {
+            auto t = trees_[(std::size_t)Side];
+            auto c = tops_[(std::size_t)Side];
+            std::size_t result = 0;
+            for (; result < m && t[1] != none; ++result) {
+                auto w = t[1];
+                level agg = *c.heads[w];
+                venues_type venues = 0;
+                for (bool first = true; w != none; w = t[1]) {
+                    const auto& l = *c.heads[w];
+                    if (not first) {
+                        if (policy::template compare<Side>(agg, l)) {
+                            break;
+                        }
+                        policy::combine(agg, l);
+                    }
+                    first = false;
+                    venues |= (venues_type)1 << w;
+                    c.heads[w] = at_<Side>(w, ++c.positions[w]);
+                    replay_<Side>(t, w, c);
+                }
+                fn(static_cast<const level&>(agg), venues);
+            }
+            return result;
+        }
+    };
+} // namespace market
@@ -0,0 +1,129 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "book.hpp"
+
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace market::delta {
+    using market::action;
+
+    // Single change of a book. Levels are identified by the Policy comparison, i.e. "update" and
+    // "erase" refer to the level which compares equal to "level" on the given side.
+    template <typename Level>
+    struct op {
+        action what;
+        std::uint8_t side; // market::side, stored in a single byte
+        Level level;
+    };
+
+    namespace impl {
+        template <typename Level>
+        bool same(const Level& lh, const Level& rh) {
+            if constexpr (requires { { lh == rh } -> std::convertible_to<bool>; }) {
+                return lh == rh;
+            } else {
+                static_assert(std::is_trivially_copyable_v<Level>);
+                return std::memcmp((const void*)&lh, (const void*)&rh, sizeof(Level)) == 0;
+            }
+        }
+
+        // Both sides must be sorted. All erase and update operations are emitted before insert, so
+        // the capacity of the book is never exceeded when these operations are applied in order.
+        template <side Side, typename Level, typename Policy, typename Index, int Capacity, typename Out>
+        Out diff(const book<Level, Policy, Index, Capacity>& from, const book<Level, Policy, Index, Capacity>& to,
+                 Out out) {
+            using level = typename book<Level, Policy, Index, Capacity>::level;
+            using size_type = typename book<Level, Policy, Index, Capacity>::size_type;
+            const auto fs = from.template size<Side>();
+            const auto ts = to.template size<Side>();
+            constexpr auto s = (std::uint8_t)Side;
+
+            size_type i = 0, j = 0;
+            while (i < fs) {
+                const level& f = from.template at<Side>(i);
+                if (j == ts || Policy::template compare<Side>(f, to.template at<Side>(j))) {
+                    *out++ = op<level>{action::erase, s, f};
+                    ++i;
+                } else if (Policy::template compare<Side>(to.template at<Side>(j), f)) {
+                    ++j;
+                } else {
+                    const level& t = to.template at<Side>(j);
+                    if (not impl::same(f, t)) {
+                        *out++ = op<level>{action::update, s, t};
+                    }
+                    ++i;
+                    ++j;
+                }
+            }
+
+            for (i = 0, j = 0; j < ts;) {
+                const level& t = to.template at<Side>(j);
+                if (i == fs || Policy::template compare<Side>(t, from.template at<Side>(i))) {
+                    *out++ = op<level>{action::insert, s, t};
+                    ++j;
+                } else if (Policy::template compare<Side>(from.template at<Side>(i), t)) {
+                    ++i;
+                } else {
+                    ++i;
+                    ++j;
+                }
+            }
+            return out;
+        }
+    }
+
+    // Write to out operations which change book "from" into book "to" (e.g. the last published state
+    // of a book and its current state) and return the final position of out, which must be an output
+    // iterator accepting op<level>. Both books must be sorted.
+    template <typename Level, typename Policy, typename Index, int Capacity, typename Out>
+    Out diff(const book<Level, Policy, Index, Capacity>& from, const book<Level, Policy, Index, Capacity>& to,
+             Out out) {
+        out = impl::diff<side::bid>(from, to, out);
+        return impl::diff<side::ask>(from, to, out);
+    }
+
+    // Apply operations in range [first, last) to the book, which must be sorted. Returns the position
+    // of the first operation which could not be applied (i.e. the level to update or erase is missing,
+    // or there is no space to insert a level), or last if all operations were applied.
+    template <typename Level, typename Policy, typename Index, int Capacity, typename It>
+    It apply(book<Level, Policy, Index, Capacity>& b, It first, It last) {
+        using size_type = typename book<Level, Policy, Index, Capacity>::size_type;
+        constexpr auto npos = book<Level, Policy, Index, Capacity>::npos;
+        auto one = [&b]<side Side>(const auto& o) -> bool {
+            if (o.what == action::insert) {
+                return b.template insert<Side>(o.level) != npos;
+            }
+            const size_type i = b.template find<Side>(o.level);
+            if (i == npos) {
+                return false;
+            }
+            if (o.what == action::update) {
+                b.template at<Side>(i) = o.level;
+                if constexpr (book<Level, Policy, Index, Capacity>::cumulative) {
+                    b.template recount<Side>(i);
+                }
+            } else {
+                b.template remove<Side>(i);
+            }
+            return true;
+        };
+
+        for (; first != last; ++first) {
+            const auto& o = *first;
+            if (not (o.side == (std::uint8_t)side::bid
+                     ? one.template operator()<side::bid>(o)
+                     : one.template operator()<side::ask>(o))) {
+                break;
+            }
+        }
+        return first;
+    }
+} // namespace market::delta
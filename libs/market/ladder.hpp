@@ -0,0 +1,342 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "common/utils.hpp"
+#include "market.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+namespace market {
+    // Market book for instruments with a fixed tick size, trading in a band narrower than Ticks. Levels
+    // are stored in a circular array indexed by price in ticks, which covers the window of prices from
+    // anchor() to anchor() + Ticks - 1. If a level outside of this window is inserted, the window is
+    // moved (without moving any levels) as long as all present levels still fit in it; otherwise the
+    // insertion fails. Position of levels within the window is recorded in a bitmap for each side, used
+    // to find the levels by their position from the top of the book.
+    //
+    // Provides the same side-templated functions as class book, with the following differences:
+    // * every price is stored in a single level, i.e. insert() replaces an existing level with the
+    //   same price rather than adding another one
+    // * lookup, insertion and removal by price in ticks are O(1), see get(), set() and erase()
+    // * functions accepting or returning a position are O(Ticks / 64), since they scan the bitmap;
+    //   this includes insert() and emplace(), which return the position of the inserted level
+    // * moving the window (on insert() or set() of a price outside of it) is O(Ticks), since it
+    //   shifts the bitmaps
+    // * there is no separation of storage and behaviour, this class owns the levels
+    //
+    // The Policy must provide function "tick", returning the price in ticks of a level and of the
+    // result of "make" (which is used by binary_search() etc. as in class book). Higher prices are
+    // closer to the top of the book on bid side, and lower prices on ask side.
+    template <typename Level, typename Policy = Level, int Ticks = 256>
+    struct ladder {
+        using level = typename std::remove_cv<typename std::remove_reference<Level>::type>::type;
+        static_assert(Ticks >= 64 && Ticks <= 32768 && std::has_single_bit((unsigned)Ticks));
+        using size_type = std::uint16_t;
+        using ticks_type = std::int32_t;
+        constexpr static size_type npos = (size_type)(-1);
+        constexpr static size_type capacity = (size_type)Ticks;
+
+    private:
+        constexpr static int words = Ticks / 64;
+        constexpr static std::uint32_t mask = (std::uint32_t)Ticks - 1;
+
+        template <typename Value>
+        static constexpr ticks_type tick(const Value& v) noexcept {
+            return (ticks_type)Policy::tick(v);
+        }
+
+        template <typename ... Args>
+        static constexpr auto make(Args&& ... a) noexcept {
+            return Policy::make(std::forward<Args>(a)...);
+        }
+
+        // Slot in the levels array, for price t
+        static constexpr std::size_t slot(ticks_type t) noexcept {
+            return (std::uint32_t)t & mask;
+        }
+
+        // Number of bits set in the bitmap of Side, at offsets lower than o (which must be in the range
+        // from 0 to Ticks inclusive)
+        template <side Side>
+        int below_(int o) const noexcept {
+            const auto* const b = bits_[(size_t)Side];
+            int result = 0;
+            int w = 0;
+            for (; w < o / 64; ++w) {
+                result += std::popcount(b[w]);
+            }
+            if (o % 64 != 0) {
+                result += std::popcount(b[w] & ((1ull << (o % 64)) - 1));
+            }
+            return result;
+        }
+
+        // Number of levels closer to the top of the book than price t (if Equal, also level at t)
+        template <side Side, bool Equal>
+        size_type count_(ticks_type t) const noexcept {
+            // Offset of t in the window, clamped to range -1 to Ticks
+            const auto d = (std::int64_t)t - anchor_;
+            const int o = d < -1 ? -1 : (d > Ticks ? Ticks : (int)d);
+            if constexpr (Side == side::ask) {
+                const int e = Equal ? o + 1 : o;
+                return (size_type)(e <= 0 ? 0 : below_<Side>(e > Ticks ? Ticks : e));
+            } else {
+                const int e = Equal ? o : o + 1;
+                return (size_type)(size_[(size_t)Side] - (e <= 0 ? 0 : below_<Side>(e > Ticks ? Ticks : e)));
+            }
+        }
+
+        // Offset in the window of the level at position i from the top of the book on Side
+        template <side Side>
+        int select_(size_type i) const noexcept {
+            const auto* const b = bits_[(size_t)Side];
+            int r = i;
+            for (int n = 0; n < words; ++n) {
+                const int w = Side == side::ask ? n : words - 1 - n;
+                const int c = std::popcount(b[w]);
+                if (r < c) {
+                    // Position of r-th lowest (or highest on bid side) bit set in this word
+                    auto v = b[w];
+                    for (int k = Side == side::ask ? r : c - 1 - r; k > 0; --k) {
+                        v &= v - 1;
+                    }
+                    return w * 64 + std::countr_zero(v);
+                }
+                r -= c;
+            }
+            return -1;
+        }
+
+        // Move the window, so it contains price t and all levels currently present. Returns false if
+        // not possible
+        bool recentre_(ticks_type t) noexcept {
+            int lo = Ticks, hi = -1;
+            for (int w = 0; w < words; ++w) {
+                const auto v = bits_[0][w] | bits_[1][w];
+                if (v != 0) {
+                    lo = lo < Ticks ? lo : w * 64 + std::countr_zero(v);
+                    hi = w * 64 + 63 - std::countl_zero(v);
+                }
+            }
+            if (hi < 0) {
+                anchor_ = (std::int64_t)t - Ticks / 2;
+                return true;
+            }
+
+            const auto low = std::min<std::int64_t>(anchor_ + lo, t);
+            const auto high = std::max<std::int64_t>(anchor_ + hi, t);
+            if (high - low >= Ticks) {
+                return false;
+            }
+            // Prefer new window centred on the range of prices
+            auto a = (low + high) / 2 - Ticks / 2;
+            a = std::min(low, std::max(high - Ticks + 1, a));
+            shift_(a - anchor_);
+            anchor_ = a;
+            return true;
+        }
+
+        // Shift bitmaps of both sides by d bits towards lower offsets (or higher, if d is negative)
+        void shift_(std::int64_t d) noexcept {
+            for (auto* b : {bits_[0], bits_[1]}) {
+                std::uint64_t tmp[words] = {};
+                for (int o = 0; o < Ticks; ++o) {
+                    const auto n = o - d;
+                    if (n >= 0 && n < Ticks && (b[o / 64] & (1ull << (o % 64))) != 0) {
+                        tmp[n / 64] |= 1ull << (n % 64);
+                    }
+                }
+                for (int w = 0; w < words; ++w) {
+                    b[w] = tmp[w];
+                }
+            }
+        }
+
+        // Mark price t present on Side, moving the window if needed. Returns pointer to the slot or
+        // nullptr if price t cannot fit in the window.
+        template <side Side>
+        level* claim_(ticks_type t, bool& existing) noexcept {
+            auto o = (std::int64_t)t - anchor_;
+            if (o < 0 || o >= Ticks) {
+                if (not recentre_(t)) {
+                    return nullptr;
+                }
+                o = (std::int64_t)t - anchor_;
+            }
+            auto& w = bits_[(size_t)Side][o / 64];
+            const auto bit = 1ull << (o % 64);
+            existing = (w & bit) != 0;
+            if (not existing) {
+                w |= bit;
+                ++size_[(size_t)Side];
+            }
+            return &levels_[(size_t)Side][slot(t)];
+        }
+
+        template <side Side>
+        bool present_(ticks_type t) const noexcept {
+            const auto o = (std::int64_t)t - anchor_;
+            return o >= 0 && o < Ticks && (bits_[(size_t)Side][o / 64] & (1ull << (o % 64))) != 0;
+        }
+
+        level levels_[2][Ticks] = {};
+        std::uint64_t bits_[2][words] = {};
+        size_type size_[2] = {0, 0};
+        std::int64_t anchor_ = 0;
+
+    public:
+        ladder() = default;
+
+        // Lowest price in the current window
+        std::int64_t anchor() const noexcept {
+            return anchor_;
+        }
+
+        void reset() noexcept {
+            for (int w = 0; w < words; ++w) {
+                bits_[0][w] = bits_[1][w] = 0;
+            }
+            size_[0] = size_[1] = 0;
+        }
+
+        template <side Side>
+        size_type size() const {
+            return size_[(size_t)Side];
+        }
+
+        template <side Side>
+        bool empty() const {
+            return size_[(size_t)Side] == 0;
+        }
+
+        template <side Side>
+        bool full() const {
+            return size_[(size_t)Side] == capacity;
+        }
+
+        template <side Side>
+        const level& at(size_type i) const {
+            ASSERT(i < size_[(size_t)Side]);
+            return levels_[(size_t)Side][slot((ticks_type)(anchor_ + select_<Side>(i)))];
+        }
+
+        template <side Side>
+        level& at(size_type i) {
+            ASSERT(i < size_[(size_t)Side]);
+            return levels_[(size_t)Side][slot((ticks_type)(anchor_ + select_<Side>(i)))];
+        }
+
+        // Top level on the given Side, or nullptr if empty
+        template <side Side>
+        const level* top() const {
+            return size_[(size_t)Side] == 0 ? nullptr : &at<Side>(0);
+        }
+
+        // Level with price t on the given Side, or nullptr if not present. O(1)
+        template <side Side>
+        level* get(ticks_type t) {
+            return present_<Side>(t) ? &levels_[(size_t)Side][slot(t)] : nullptr;
+        }
+
+        template <side Side>
+        const level* get(ticks_type t) const {
+            return present_<Side>(t) ? &levels_[(size_t)Side][slot(t)] : nullptr;
+        }
+
+        // Remove level with price t from the given Side, returns false if not present. O(1)
+        template <side Side>
+        bool erase(ticks_type t) {
+            if (not present_<Side>(t)) {
+                return false;
+            }
+            const auto o = (std::int64_t)t - anchor_;
+            bits_[(size_t)Side][o / 64] &= ~(1ull << (o % 64));
+            --size_[(size_t)Side];
+            return true;
+        }
+
+        // Store level on the given Side, replacing the level with the same price if present. Returns
+        // pointer to the stored level, or nullptr if its price does not fit in the window. Same as
+        // insert(), but O(1) (unless the window is moved) since it does not compute the position
+        template <side Side, typename Type>
+        level* set(Type&& a) {
+            bool existing = false;
+            auto* const l = claim_<Side>(ladder::tick(a), existing);
+            if (l != nullptr) {
+                *l = std::forward<Type>(a);
+            }
+            return l;
+        }
+
+        // Store level on the given Side, replacing the level with the same price if present. Returns
+        // the position of the level, or npos if its price does not fit in the window.
+        template <side Side, typename Type>
+        size_type insert(Type&& a) {
+            const auto t = ladder::tick(a);
+            bool existing = false;
+            auto* const l = claim_<Side>(t, existing);
+            if (l == nullptr) {
+                return npos;
+            }
+            *l = std::forward<Type>(a);
+            return count_<Side, false>(t);
+        }
+
+        template <side Side, typename ... Args>
+        size_type emplace(Args&& ... a) {
+            const level v{std::forward<Args>(a)...};
+            return insert<Side>(v);
+        }
+
+        template <side Side>
+        void remove(size_type i) {
+            ASSERT(i < size_[(size_t)Side]);
+            const int o = select_<Side>(i);
+            bits_[(size_t)Side][o / 64] &= ~(1ull << (o % 64));
+            --size_[(size_t)Side];
+        }
+
+        template <side Side, typename ... Args>
+        size_type binary_search(Args&& ... a) const {
+            const auto t = ladder::tick(ladder::make(std::forward<Args>(a)...));
+            return present_<Side>(t) ? count_<Side, false>(t) : npos;
+        }
+
+        template <side Side, typename ... Args>
+        size_type lower_bound(Args&& ... a) const {
+            const auto i = count_<Side, false>(ladder::tick(ladder::make(std::forward<Args>(a)...)));
+            return i == size_[(size_t)Side] ? npos : i;
+        }
+
+        template <side Side, typename ... Args>
+        size_type upper_bound(Args&& ... a) const {
+            const auto i = count_<Side, true>(ladder::tick(ladder::make(std::forward<Args>(a)...)));
+            return i == size_[(size_t)Side] ? npos : i;
+        }
+
+        template <side Side, typename ... Args>
+        std::pair<size_type, size_type> equal_range(Args&& ... a) const {
+            const auto t = ladder::tick(ladder::make(std::forward<Args>(a)...));
+            const auto size = size_[(size_t)Side];
+            const auto l = count_<Side, false>(t);
+            const auto u = count_<Side, true>(t);
+            return std::make_pair(l == size ? npos : l, u == size ? npos : u);
+        }
+
+        template <side Side>
+        size_type find(const level& v) const {
+            const auto t = ladder::tick(v);
+            return present_<Side>(t) ? count_<Side, false>(t) : npos;
+        }
+    };
+} // namespace market
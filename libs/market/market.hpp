@@ -5,11 +5,51 @@
 
 #pragma once
 
+#include <array>
 #include <cstddef>
+#include <cstdint>
 
 namespace market {
     // Used for indexing, so give it appropriate underlying type
     enum class side : size_t { bid = 0, ask = 1 };
 
-    template <typename Level, typename Policy> struct book;
+    // Search mode of a book, selected by the Policy. Linear search is faster than binary search for
+    // shallow books, but requires the Policy to provide a dense integer key of each level.
+    enum class search { binary = 0, linear = 1 };
+
+    // Change of a single level, used by book::apply_batch() and in delta encoding
+    enum class action : std::uint8_t { insert = 0, update = 1, erase = 2 };
+
+    // Events counted by a book with instrumented Policy, see book::stats() and class stats
+    enum class metric : std::uint8_t {
+        compare = 0, // Comparison of levels, or of keys in linear search mode
+        shift = 1, // Bytes moved when shifting arrays of indices and keys
+        pop = 2, // Index taken from the free list
+        push = 3, // Index returned to the free list
+        reject = 4, // Level not added because the side is full
+        search = 5, // Call of a search function, e.g. binary_search() or find()
+        sort = 6 // Call of sort()
+    };
+    constexpr std::size_t metric_count = 7;
+
+    struct counters {
+        std::array<std::uint64_t, metric_count> values = {};
+
+        constexpr void add(metric e, std::uint64_t n) noexcept {
+            values[(std::size_t)e] += n;
+        }
+
+        constexpr std::uint64_t operator[](metric e) const noexcept {
+            return values[(std::size_t)e];
+        }
+
+        constexpr counters& operator+=(const counters& o) noexcept {
+            for (std::size_t i = 0; i < metric_count; ++i) {
+                values[i] += o.values[i];
+            }
+            return *this;
+        }
+    };
+
+    template <typename Level, typename Policy, typename Index, int Capacity> struct book;
 } // namespace market
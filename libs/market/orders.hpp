@@ -0,0 +1,294 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "book.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace market {
+    // Order by order (L3) book, layered on top of a book of price levels. Every level owns a FIFO queue
+    // of orders, linked by indices in a pool of order nodes allocated once on construction (i.e. the
+    // same as "sides" and "freel" in class book, no pointers are stored). Orders are also indexed by id
+    // in an open addressing hash table, so cancel() and execute() are O(1), as well as add() to an
+    // existing level, apart from finding the level with find(). Levels are inserted into the book when
+    // the first order at their price is added, and removed when the last order is gone.
+    //
+    // The Policy must provide, in addition to functions required by class book, function "open",
+    // returning an empty level (i.e. with zero quantity) with the given price in ticks, and function
+    // "adjust", adding the given (possibly negative) quantity to the aggregate quantity of a level.
+    template <typename Level, typename Policy = Level, typename Index = uint8_t>
+    class orders {
+    public:
+        using book_type = market::book<Level, Policy, Index>;
+        using level = typename book_type::level;
+        using size_type = typename book_type::size_type;
+        using key_type = typename book_type::key_type;
+        using id_type = std::uint64_t;
+        using quantity_type = std::int64_t;
+        using ticks_type = std::int64_t;
+        using node_type = std::uint32_t; // Index of an order in the pool
+        constexpr static node_type npos = (node_type)(-1);
+        // Quantities of levels are changed in place by "adjust", which does not update totals
+        static_assert(not book_type::cumulative, "cumulative totals are not supported");
+
+        struct order {
+            id_type id;
+            quantity_type quantity;
+            node_type next; // Next order in the queue of the same level, or in the free list
+            node_type prev;
+            size_type slot; // Index of the level in "levels" array of the book
+            std::uint8_t side; // market::side, stored in a single byte
+        };
+
+    private:
+        // Owns the arrays of the book and exposes position of levels in "levels" array, which does
+        // not change while the level is present, unlike its position on a side. Free list is
+        // populated by reset(), called from clear()
+        struct storage : book_type {
+            std::unique_ptr<level[]> levels_;
+            std::unique_ptr<size_type[]> sides_;
+            std::unique_ptr<size_type[]> freel_;
+            std::unique_ptr<key_type[]> keys_;
+
+            explicit storage(int capacity)
+                    : book_type(nullptr, nullptr, nullptr, capacity, 0, 0)
+                    , levels_(new level[(std::size_t)capacity * 2])
+                    , sides_(new size_type[(std::size_t)capacity * 2])
+                    , freel_(new size_type[(std::size_t)capacity * 2]) {
+                this->levels = levels_.get();
+                this->sides = sides_.get();
+                this->freel = freel_.get();
+                if constexpr (book_type::linear) {
+                    keys_.reset(new key_type[(std::size_t)capacity * 2]);
+                    this->keys = keys_.get();
+                }
+            }
+
+            using book_type::reset;
+
+            template <side Side>
+            size_type slot(size_type i) const {
+                return this->sides[(std::size_t)Side * this->capacity + i];
+            }
+
+            level& get(size_type slot) {
+                return this->levels[slot];
+            }
+        };
+
+        static std::size_t table_size(std::uint32_t count) {
+            std::size_t result = 16;
+            while (result < (std::size_t)count * 2) {
+                result *= 2;
+            }
+            return result;
+        }
+
+        std::size_t hash_(id_type id) const {
+            return (std::size_t)((id * 0x9e3779b97f4a7c15ull) >> shift_);
+        }
+
+        // Position in table_ of order id, or of the empty entry where it would be stored
+        std::size_t probe_(id_type id) const {
+            auto h = hash_(id);
+            for (; table_[h] != npos && pool_[table_[h]].id != id; h = (h + 1) & mask_) {
+            }
+            return h;
+        }
+
+        // Remove entry at position h from table_, moving back entries which follow it in the same
+        // cluster (i.e. backward shift deletion, which does not need tombstones)
+        void unlink_id_(std::size_t h) {
+            for (auto j = (h + 1) & mask_; table_[j] != npos; j = (j + 1) & mask_) {
+                const auto k = hash_(pool_[table_[j]].id);
+                // Move entry j to h, unless its home position k is cyclically in range (h, j]
+                if (((j - k) & mask_) >= ((j - h) & mask_)) {
+                    table_[h] = table_[j];
+                    h = j;
+                }
+            }
+            table_[h] = npos;
+        }
+
+        // Remove order n from the queue of its level and from the id index, return it to the pool and
+        // remove the level if its queue is now empty
+        template <side Side>
+        void erase_(node_type n, std::size_t h) {
+            auto& o = pool_[n];
+            const auto s = o.slot;
+            Policy::adjust(book_.get(s), -o.quantity);
+            if (o.prev != npos) {
+                pool_[o.prev].next = o.next;
+            } else {
+                head_[s] = o.next;
+            }
+            if (o.next != npos) {
+                pool_[o.next].prev = o.prev;
+            } else {
+                tail_[s] = o.prev;
+            }
+            if (head_[s] == npos) {
+                const auto i = book_.template find<Side>(book_.get(s));
+                ASSERT(i != book_type::npos);
+                book_.template remove<Side>(i);
+            }
+            unlink_id_(h);
+            o.next = free_;
+            free_ = n;
+            --size_;
+        }
+
+        storage book_;
+        std::vector<node_type> head_; // First order in the queue of each level, by its slot
+        std::vector<node_type> tail_;
+        std::vector<order> pool_;
+        std::vector<node_type> table_; // Orders by id, npos if empty
+        std::size_t mask_;
+        int shift_;
+        node_type free_ = npos;
+        std::uint32_t size_ = 0;
+
+    public:
+        // Book of "capacity" levels on each side, for at most "count" orders in total. Can throw
+        // book_type::bad_capacity
+        orders(int capacity, std::uint32_t count)
+                : book_(capacity)
+                , head_((std::size_t)capacity * 2, npos)
+                , tail_((std::size_t)capacity * 2, npos)
+                , pool_(count)
+                , table_(table_size(count), npos)
+                , mask_(table_.size() - 1)
+                , shift_(64 - std::countr_zero(table_.size())) {
+            clear();
+        }
+
+        orders(const orders& ) = delete;
+        orders& operator=(const orders& ) = delete;
+
+        // Levels, with aggregate quantity of their orders
+        const book_type& book() const { return book_; }
+        // Number of orders
+        std::uint32_t size() const { return size_; }
+        std::uint32_t capacity() const { return (std::uint32_t)pool_.size(); }
+
+        void clear() {
+            book_.reset();
+            std::fill(head_.begin(), head_.end(), npos);
+            std::fill(tail_.begin(), tail_.end(), npos);
+            std::fill(table_.begin(), table_.end(), npos);
+            for (std::size_t i = 0; i < pool_.size(); ++i) {
+                pool_[i].next = i + 1 < pool_.size() ? (node_type)(i + 1) : npos;
+            }
+            free_ = pool_.empty() ? npos : 0;
+            size_ = 0;
+        }
+
+        // Order with given id, or nullptr
+        const order* get(id_type id) const {
+            const auto n = table_[probe_(id)];
+            return n == npos ? nullptr : &pool_[n];
+        }
+
+        // Add order at the back of the queue of the level with price ticks, inserting the level if
+        // needed. Returns false if quantity is not positive, id is already present, there is no space
+        // left for orders, or no space left on this side of the book for a new level.
+        template <side Side>
+        bool add(id_type id, ticks_type ticks, quantity_type quantity) {
+            if (quantity <= 0) {
+                return false;
+            }
+            const auto h = probe_(id);
+            if (table_[h] != npos || free_ == npos) {
+                return false;
+            }
+            const level l = Policy::open(ticks);
+            auto i = book_.template find<Side>(l);
+            if (i == book_type::npos) {
+                i = book_.template insert<Side>(l);
+                if (i == book_type::npos) {
+                    return false;
+                }
+            }
+            const auto s = book_.template slot<Side>(i);
+            Policy::adjust(book_.get(s), quantity);
+
+            const auto n = free_;
+            free_ = pool_[n].next;
+            pool_[n] = order{id, quantity, npos, tail_[s], s, (std::uint8_t)Side};
+            if (tail_[s] != npos) {
+                pool_[tail_[s]].next = n;
+            } else {
+                head_[s] = n;
+            }
+            tail_[s] = n;
+            table_[h] = n;
+            ++size_;
+            return true;
+        }
+
+        // Remove order, and its level if no other orders are left on it. Returns false if not found
+        bool cancel(id_type id) {
+            const auto h = probe_(id);
+            const auto n = table_[h];
+            if (n == npos) {
+                return false;
+            }
+            if (pool_[n].side == (std::uint8_t)side::bid) {
+                erase_<side::bid>(n, h);
+            } else {
+                erase_<side::ask>(n, h);
+            }
+            return true;
+        }
+
+        // Reduce quantity of the order by at most "quantity", keeping its place in the queue, or remove
+        // it if nothing is left. Returns the quantity executed, i.e. 0 if the order was not found or
+        // quantity is not positive.
+        quantity_type execute(id_type id, quantity_type quantity) {
+            const auto h = probe_(id);
+            const auto n = table_[h];
+            if (n == npos || quantity <= 0) {
+                return 0;
+            }
+            auto& o = pool_[n];
+            if (quantity < o.quantity) {
+                o.quantity -= quantity;
+                Policy::adjust(book_.get(o.slot), -quantity);
+                return quantity;
+            }
+            const auto result = o.quantity;
+            if (o.side == (std::uint8_t)side::bid) {
+                erase_<side::bid>(n, h);
+            } else {
+                erase_<side::ask>(n, h);
+            }
+            return result;
+        }
+
+        // Call fn(order) for orders of the level at position i on Side, in the order of priority
+        template <side Side, typename Fn>
+        void for_each(size_type i, Fn&& fn) const {
+            for (auto n = head_[book_.template slot<Side>(i)]; n != npos; n = pool_[n].next) {
+                fn(pool_[n]);
+            }
+        }
+
+        // First order in the queue of the level at position i on Side
+        template <side Side>
+        const order& front(size_type i) const {
+            const auto n = head_[book_.template slot<Side>(i)];
+            ASSERT(n != npos);
+            return pool_[n];
+        }
+    };
+} // namespace market
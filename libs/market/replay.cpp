@@ -0,0 +1,146 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "replay.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <random>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace market::replay {
+    namespace {
+        [[noreturn]] void fail(const char* what, const std::string& path) {
+            throw std::system_error(errno, std::generic_category(), std::string(what) + " " + path);
+        }
+
+        // Closes the file descriptor on scope exit, the mapping remains valid after that
+        struct descriptor {
+            const int fd;
+            ~descriptor() { ::close(fd); }
+        };
+    }
+
+    file::file(const std::string& path) {
+        const descriptor f{::open(path.c_str(), O_RDONLY)};
+        if (f.fd < 0) {
+            fail("open", path);
+        }
+        struct stat st = {};
+        if (::fstat(f.fd, &st) != 0) {
+            fail("fstat", path);
+        }
+        const auto size = (std::size_t)st.st_size;
+        if (size < sizeof(file_header)) {
+            throw bad_file(path);
+        }
+        void* const data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, f.fd, 0);
+        if (data == MAP_FAILED) {
+            fail("mmap", path);
+        }
+        data_ = data;
+        size_ = size;
+        ::madvise(data_, size_, MADV_SEQUENTIAL); // Advisory only, failure is not an error
+
+        const auto& h = header();
+        if (h.magic != file_header::magic_value || h.version != file_header::version_value
+            || h.record_size != sizeof(record)
+            || h.count > (size - sizeof(file_header)) / sizeof(record)) {
+            ::munmap(data_, size_);
+            throw bad_file(path);
+        }
+    }
+
+    file::file(file&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr))
+        , size_(std::exchange(other.size_, 0))
+    { }
+
+    file::~file() {
+        if (data_ != nullptr) {
+            ::munmap(data_, size_);
+        }
+    }
+
+    const record* file::begin() const {
+        return reinterpret_cast<const record*>(static_cast<const std::byte*>(data_) + sizeof(file_header));
+    }
+
+    void write(const std::string& path, const record* first, const record* last) {
+        std::FILE* const f = std::fopen(path.c_str(), "wb");
+        if (f == nullptr) {
+            fail("fopen", path);
+        }
+        const auto count = (std::size_t)(last - first);
+        const file_header h{file_header::magic_value, file_header::version_value, sizeof(record), count};
+        const bool ok = std::fwrite(&h, sizeof(h), 1, f) == 1
+                        && (count == 0 || std::fwrite(first, sizeof(record), count, f) == count);
+        if (std::fclose(f) != 0 || not ok) {
+            fail("fwrite", path);
+        }
+    }
+
+    std::vector<record> generate(std::size_t count, std::uint32_t instruments, std::uint64_t seed) {
+        std::vector<record> result;
+        if (instruments == 0) {
+            return result;
+        }
+        result.reserve(count);
+
+        // Levels present in the book of each instrument, bit k is set if price "mid - 1 - k" is present
+        // on bid side (or "mid + 1 + k" on ask side). Mid price does not change.
+        std::vector<std::uint64_t> present((std::size_t)instruments * 2, 0);
+        std::mt19937_64 gen(seed);
+        std::uint64_t time = 0;
+        for (std::size_t n = 0; n < count; ++n) {
+            const auto r = gen();
+            const auto instrument = (std::uint32_t)(r % instruments);
+            const auto s = (std::uint8_t)((r >> 32) & 1);
+            // Skewed towards the top of the book, as in real feeds
+            const auto k = (int)std::min<std::uint64_t>(((r >> 33) & 63) * ((r >> 39) & 63) / 63, 63);
+            const auto choice = (r >> 45) & 1023;
+            const std::int32_t mid = 10000 + (std::int32_t)instrument * 100;
+            const std::int32_t ticks = s == (std::uint8_t)side::bid ? mid - 1 - k : mid + 1 + k;
+            const auto quantity = (std::int64_t)((r >> 55) + 1);
+            auto& bits = present[(std::size_t)instrument * 2 + s];
+            time += 1 + ((r >> 20) & 1023);
+
+            record e = {time, instrument, ticks, quantity, event::add, s, {}};
+            if (choice == 0) {
+                e.type = event::clear;
+                e.ticks = 0;
+                e.quantity = 0;
+                present[(std::size_t)instrument * 2] = present[(std::size_t)instrument * 2 + 1] = 0;
+            } else if ((bits & (1ull << k)) == 0) {
+                bits |= 1ull << k;
+            } else if (choice < 700) {
+                e.type = event::modify;
+            } else {
+                e.type = event::erase;
+                e.quantity = 0;
+                bits &= ~(1ull << k);
+            }
+            result.push_back(e);
+        }
+        return result;
+    }
+
+    std::uint64_t instruments(const record* first, const record* last) {
+        std::uint64_t result = 0;
+        for (; first != last; ++first) {
+            if (first->instrument < record::max_instruments) {
+                result = std::max(result, (std::uint64_t)first->instrument + 1);
+            }
+        }
+        return result;
+    }
+} // namespace market::replay
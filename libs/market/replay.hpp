@@ -0,0 +1,240 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "arena.hpp"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace market::replay {
+    // Replay file is a header followed by "count" fixed size records, in native byte order. Every
+    // record is an event applied to the book of a single instrument:
+    //
+    //   add     insert a new level with given ticks and quantity; if the level already exists, then
+    //           its quantity is replaced (i.e. same as modify)
+    //   modify  replace quantity of an existing level with given ticks
+    //   erase   remove an existing level with given ticks, quantity is ignored
+    //   clear   remove all levels from both sides, ticks, quantity and side are ignored
+    //
+    // Events which cannot be applied (e.g. modify of a missing level, add to a full side, or any event
+    // of an instrument id not smaller than record::max_instruments) are counted as dropped.
+    struct file_header {
+        constexpr static std::uint64_t magic_value = 0x594c5052544b4d; // "MKTRPLY"
+        constexpr static std::uint32_t version_value = 1;
+
+        std::uint64_t magic;
+        std::uint32_t version;
+        std::uint32_t record_size; // sizeof(record)
+        std::uint64_t count; // Number of records
+    };
+
+    enum class event : std::uint8_t {
+        add = 0,
+        modify = 1,
+        erase = 2,
+        clear = 3
+    };
+
+    struct record {
+        // Instrument ids must be smaller, since books are looked up by id in an array
+        constexpr static std::uint32_t max_instruments = 1u << 24;
+
+        std::uint64_t time; // Nanoseconds, not interpreted by the engine
+        std::uint32_t instrument;
+        std::int32_t ticks;
+        std::int64_t quantity;
+        event type;
+        std::uint8_t side; // market::side
+        std::uint8_t reserved[6];
+    };
+    static_assert(sizeof(record) == 32);
+    static_assert(sizeof(file_header) == 24);
+
+    // Thrown if a file is not a valid replay file
+    struct bad_file : std::runtime_error {
+        explicit bad_file(const std::string& path)
+            : std::runtime_error("invalid market replay file " + path)
+        { }
+    };
+
+    // Replay file mapped read-only in the address space of this process. Failures of system calls
+    // are reported as system_error. Records are not validated, since that would read the whole file.
+    class file {
+        void* data_ = nullptr;
+        std::size_t size_ = 0;
+
+    public:
+        explicit file(const std::string& path);
+        file(file&& other) noexcept;
+        file& operator=(file&& ) = delete;
+        ~file();
+
+        const file_header& header() const { return *static_cast<const file_header*>(data_); }
+        const record* begin() const;
+        const record* end() const { return begin() + size(); }
+        std::size_t size() const { return (std::size_t)header().count; }
+    };
+
+    // Write replay file with given records, replacing any existing file
+    void write(const std::string& path, const record* first, const record* last);
+
+    // Random but valid sequence of events, e.g. for benchmarks. Each instrument has at most 64 levels
+    // on each side, so the events can be applied to books of that capacity without any dropped.
+    std::vector<record> generate(std::size_t count, std::uint32_t instruments, std::uint64_t seed);
+
+    // Largest instrument id in the range plus 1, i.e. the number of books required to replay it. Ids
+    // not smaller than record::max_instruments are ignored, since their events are dropped.
+    std::uint64_t instruments(const record* first, const record* last);
+
+    struct level {
+        std::int32_t ticks;
+        std::int64_t quantity;
+
+        template <side Side>
+        constexpr static bool compare(const level& lh, const level& rh) noexcept {
+            if constexpr (Side == side::bid) {
+                return lh.ticks > rh.ticks;
+            } else {
+                return lh.ticks < rh.ticks;
+            }
+        }
+
+        constexpr static level make(const level& l) noexcept {
+            return l;
+        }
+    };
+
+    struct stats {
+        std::uint64_t events = 0;
+        std::uint64_t dropped = 0;
+        double ns = 0.0;
+
+        double events_per_sec() const { return ns > 0.0 ? (double)events * 1e9 / ns : 0.0; }
+    };
+
+    // Dispatches events to books of instruments, stored in an arena. Books are assigned to instruments
+    // on the first event, or in advance with prepare(), after which apply() does not allocate.
+    template <typename Policy = level, typename Index = std::uint8_t>
+    class engine {
+    public:
+        using arena_type = arena<level, Policy, Index>;
+        using book_type = typename arena_type::handle;
+        static_assert(record::max_instruments <= arena_type::max_ids);
+
+        engine(std::size_t instruments, int capacity, bool huge_pages = false)
+                : books_(instruments, capacity, huge_pages)
+        { }
+
+        arena_type& books() { return books_; }
+        const arena_type& books() const { return books_; }
+
+        void prepare(const record* first, const record* last) {
+            for (; first != last; ++first) {
+                if (first->instrument < record::max_instruments) {
+                    books_.acquire(first->instrument);
+                }
+            }
+        }
+
+        // Returns false if the event was dropped
+        bool apply(const record& r) {
+            if (r.instrument >= record::max_instruments) {
+                return false;
+            }
+            auto* const b = books_.acquire(r.instrument);
+            if (b == nullptr) {
+                return false;
+            }
+            if (r.type == event::clear) {
+                b->reset();
+                return true;
+            }
+            switch ((side)r.side) {
+                case side::bid: return apply_<side::bid>(*b, r);
+                case side::ask: return apply_<side::ask>(*b, r);
+            }
+            return false;
+        }
+
+        // Apply events in range and measure the time taken
+        stats run(const record* first, const record* last) {
+            stats result;
+            const auto start = std::chrono::steady_clock::now();
+            for (; first != last; ++first) {
+                result.dropped += (std::uint64_t)(not apply(*first));
+                ++result.events;
+            }
+            const auto stop = std::chrono::steady_clock::now();
+            result.ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+            return result;
+        }
+
+        // Hash of the contents of all books, e.g. for regression tests
+        std::uint64_t checksum() const {
+            std::uint64_t h = 14695981039346656037ull;
+            auto mix = [&h](std::uint64_t v) {
+                h = (h ^ v) * 1099511628211ull;
+            };
+            for (std::size_t s = 0; s < books_.size(); ++s) {
+                const auto id = books_.owner(s);
+                if (id == arena_type::npos) {
+                    continue;
+                }
+                const auto& b = books_[id];
+                mix(id);
+                mix(b.template size<side::bid>());
+                for (int i = 0; i < (int)b.template size<side::bid>(); ++i) {
+                    mix((std::uint64_t)b.template at<side::bid>(i).ticks);
+                    mix((std::uint64_t)b.template at<side::bid>(i).quantity);
+                }
+                mix(b.template size<side::ask>());
+                for (int i = 0; i < (int)b.template size<side::ask>(); ++i) {
+                    mix((std::uint64_t)b.template at<side::ask>(i).ticks);
+                    mix((std::uint64_t)b.template at<side::ask>(i).quantity);
+                }
+            }
+            return h;
+        }
+
+    private:
+        template <side Side>
+        static bool apply_(book_type& b, const record& r) {
+            const level l{r.ticks, r.quantity};
+            const auto i = b.template find<Side>(l);
+            switch (r.type) {
+                case event::add:
+                    if (i == book_type::npos) {
+                        return b.template insert<Side>(l) != book_type::npos;
+                    }
+                    [[fallthrough]];
+                case event::modify:
+                    if (i == book_type::npos) {
+                        return false;
+                    }
+                    b.template at<Side>(i).quantity = r.quantity;
+                    if constexpr (book_type::cumulative) {
+                        b.template recount<Side>(i);
+                    }
+                    return true;
+                case event::erase:
+                    if (i == book_type::npos) {
+                        return false;
+                    }
+                    b.template remove<Side>(i);
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        arena_type books_;
+    };
+} // namespace market::replay
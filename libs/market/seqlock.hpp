@@ -0,0 +1,225 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "market.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+# include <immintrin.h>
+#endif
+
+namespace market {
+    namespace impl {
+        inline void pause() noexcept {
+#if defined(__SSE2__)
+            _mm_pause();
+#endif
+        }
+    }
+
+    // Sequence counter for a single writer thread and any number of reader threads. The writer
+    // holds a guard for the duration of every modification; readers call read() with a function
+    // which copies the data out, and which is called again if the data was modified meanwhile.
+    class seqlock {
+        std::atomic<std::uint64_t> seq_ = 0;
+
+    public:
+        // Odd value of the sequence counter means that a modification is in progress
+        class guard {
+            std::atomic<std::uint64_t>& seq_;
+            const std::uint64_t start_;
+
+        public:
+            explicit guard(seqlock& l) noexcept
+                : seq_(l.seq_)
+                , start_(seq_.load(std::memory_order_relaxed)) {
+                seq_.store(start_ + 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_release);
+            }
+
+            guard(const guard& ) = delete;
+            guard& operator=(const guard& ) = delete;
+
+            ~guard() {
+                seq_.store(start_ + 2, std::memory_order_release);
+            }
+        };
+
+        // Current value of the sequence counter, incremented by 2 by every modification
+        std::uint64_t version() const noexcept {
+            return seq_.load(std::memory_order_acquire);
+        }
+
+        // Call fn() until it completes without a concurrent modification. Function fn can also return
+        // false if it has detected inconsistent data (e.g. an index out of range) on its own, without
+        // waiting for the check of the sequence counter.
+        template <typename Fn>
+        void read(Fn&& fn) const {
+            for (;;) {
+                const auto start = seq_.load(std::memory_order_acquire);
+                if ((start & 1) == 0) {
+                    const bool valid = fn();
+                    std::atomic_thread_fence(std::memory_order_acquire);
+                    if (valid && seq_.load(std::memory_order_relaxed) == start) {
+                        return;
+                    }
+                }
+                impl::pause();
+            }
+        }
+    };
+
+    // Book with a sequence lock, for a single writer thread and any number of reader threads. Base
+    // must be a class derived from market::book, which owns the data storage. All functions of the
+    // book which modify its data are wrapped, so they increment the sequence counter before and after
+    // the modification. Anything else (e.g. changing the contents of a level in place) must be done
+    // inside write(). Readers never block the writer, instead they copy the data out and retry the
+    // copy if the sequence counter has changed in the meantime.
+    //
+    // Note, the readers perform plain (non-atomic) reads of data which can be concurrently modified
+    // by the writer. This is inherent to sequence locks; any inconsistent copy is discarded.
+    template <typename Base>
+    struct versioned : Base {
+        using level = typename Base::level;
+        using size_type = typename Base::size_type;
+        using const_iterator = typename Base::const_iterator;
+        static_assert(std::is_trivially_copyable_v<level>);
+
+        using Base::Base;
+
+    private:
+        using guard = seqlock::guard;
+        alignas(64) seqlock seq_;
+
+    public:
+        // Current value of the sequence counter, incremented by 2 by every modification
+        std::uint64_t version() const noexcept {
+            return seq_.version();
+        }
+
+        // Writer API, must be called from a single thread only
+        template <typename Fn>
+        decltype(auto) write(Fn&& fn) {
+            const guard g(seq_);
+            return std::forward<Fn>(fn)(static_cast<Base&>(*this));
+        }
+
+        template <side Side, typename Type>
+        size_type push_back(Type&& a) {
+            const guard g(seq_);
+            return Base::template push_back<Side>(std::forward<Type>(a));
+        }
+
+        template <side Side, typename ... Args>
+        size_type emplace_back(Args&& ... a) {
+            const guard g(seq_);
+            return Base::template emplace_back<Side>(std::forward<Args>(a)...);
+        }
+
+        template <side Side, typename Type>
+        size_type insert(Type&& a) {
+            const guard g(seq_);
+            return Base::template insert<Side>(std::forward<Type>(a));
+        }
+
+        template <side Side, typename ... Args>
+        size_type emplace(Args&& ... a) {
+            const guard g(seq_);
+            return Base::template emplace<Side>(std::forward<Args>(a)...);
+        }
+
+        template <side Side>
+        void remove(size_type i) {
+            const guard g(seq_);
+            Base::template remove<Side>(i);
+        }
+
+        template <side Side>
+        void sort() {
+            const guard g(seq_);
+            Base::template sort<Side>();
+        }
+
+        template <side Side>
+        size_type resort_one(size_type i) {
+            const guard g(seq_);
+            return Base::template resort_one<Side>(i);
+        }
+
+        template <side Side>
+        void recount(size_type i) requires Base::cumulative {
+            const guard g(seq_);
+            Base::template recount<Side>(i);
+        }
+
+        template <side Side, typename Op>
+        std::size_t apply_batch(std::span<Op> ops) {
+            const guard g(seq_);
+            return Base::template apply_batch<Side>(ops);
+        }
+
+        // Hides non-const overloads, levels can be only modified inside write()
+        template <side Side>
+        const level& at(size_type i) const {
+            return Base::template at<Side>(i);
+        }
+
+        template <side Side>
+        const_iterator begin() const noexcept {
+            return Base::template begin<Side>();
+        }
+
+        template <side Side>
+        const_iterator end() const noexcept {
+            return Base::template end<Side>();
+        }
+
+        template <side Side>
+        std::ranges::subrange<const_iterator> range() const noexcept {
+            return Base::template range<Side>();
+        }
+
+        // Reader API, safe to call from any thread. Copies up to n levels from the top of the given
+        // Side to out, returns the number of levels copied.
+        template <side Side>
+        size_type read(level* out, size_type n) const noexcept {
+            size_type result = 0;
+            seq_.read([&]() {
+                result = std::min<size_type>(n, std::min(this->side_i[(size_t)Side], this->capacity));
+                const auto* const begin = &this->sides[(size_t)Side * this->capacity];
+                for (size_type i = 0; i < result; ++i) {
+                    const auto l = begin[i];
+                    if (l >= this->size_i) { // Only possible if the writer is in progress
+                        return false;
+                    }
+                    std::memcpy((void*)&out[i], (const void*)&this->levels[l], sizeof(level));
+                }
+                return true;
+            });
+            return result;
+        }
+
+        // Copy sizes of both sides, as a consistent pair
+        std::pair<size_type, size_type> sizes() const noexcept {
+            std::pair<size_type, size_type> result;
+            seq_.read([&]() {
+                result = std::make_pair(this->side_i[0], this->side_i[1]);
+                return true;
+            });
+            return result;
+        }
+    };
+} // namespace market
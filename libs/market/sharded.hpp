@@ -0,0 +1,268 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "common/cpu.hpp"
+#include "replay.hpp"
+#include "seqlock.hpp"
+#include "spsc.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace market::replay {
+    namespace impl {
+        // Spin for a while, then yield, e.g. if there are more threads than CPUs
+        class backoff {
+            int spins_ = 0;
+
+        public:
+            void operator()() {
+                if (++spins_ < 256) {
+                    market::impl::pause();
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+
+            void reset() { spins_ = 0; }
+        };
+    }
+
+    // Partitions instruments across several worker threads ("shards"), each of which exclusively owns
+    // the books of its instruments, in an engine of its own. Instrument id i is owned by shard
+    // i % shards. Events are posted by a single producer thread and routed to their shard through an
+    // spsc ring; workers spin on their rings (yielding after a while if idle), applying events in
+    // batches, so they are best pinned to dedicated CPUs. Books are all assigned on construction, for
+    // ids 0 to "instruments" - 1; events of other instruments are dropped by post().
+    //
+    // Books can be read from any thread with read() and sizes(). Every book has a seqlock, held by
+    // its worker while applying an event, so readers never block workers and never see a partially
+    // applied event. The same caveat applies as for class versioned, i.e. readers perform plain reads
+    // of data which can be concurrently modified, and discard any inconsistent copy.
+    template <typename Policy = level, typename Index = std::uint8_t>
+    class sharded {
+    public:
+        using engine_type = engine<Policy, Index>;
+        using book_type = typename engine_type::book_type;
+        using size_type = typename book_type::size_type;
+        constexpr static std::size_t batch = 64; // Maximum number of events applied at once by a worker
+
+    private:
+        struct alignas(64) lock : seqlock { };
+
+        struct worker {
+            engine_type engine;
+            spsc<record> ring;
+            std::unique_ptr<lock[]> locks; // By instrument id / shards
+            // Written by the worker after every batch
+            alignas(64) std::atomic<std::uint64_t> processed = 0;
+            std::atomic<std::uint64_t> dropped = 0;
+            // Written by the producer only
+            alignas(64) std::uint64_t posted = 0;
+            std::thread thread = {};
+            bool pinned = false;
+
+            worker(std::size_t instruments, int capacity, std::size_t ring_size, bool huge_pages)
+                    : engine(instruments, capacity, huge_pages)
+                    , ring(ring_size)
+                    , locks(new lock[instruments]) {
+            }
+        };
+
+        void work_(worker& s) {
+            const auto count = (std::uint32_t)shards_.size();
+            std::uint64_t processed = 0;
+            std::uint64_t dropped = 0;
+            impl::backoff wait;
+            for (;;) {
+                const auto n = s.ring.consume([&](const record& r) {
+                    const seqlock::guard g(s.locks[r.instrument / count]);
+                    dropped += (std::uint64_t)(not s.engine.apply(r));
+                }, batch);
+                if (n == 0) {
+                    if (stop_.load(std::memory_order_acquire) && s.ring.empty()) {
+                        return;
+                    }
+                    wait();
+                    continue;
+                }
+                wait.reset();
+                processed += n;
+                s.dropped.store(dropped, std::memory_order_relaxed);
+                s.processed.store(processed, std::memory_order_release);
+            }
+        }
+
+        const book_type* find_(std::uint32_t instrument) const {
+            return instrument < instruments_
+                    ? shards_[instrument % shards_.size()]->engine.books().find(instrument)
+                    : nullptr;
+        }
+
+        const seqlock& lock_(std::uint32_t instrument) const {
+            const auto count = shards_.size();
+            return shards_[instrument % count]->locks[instrument / count];
+        }
+
+        std::vector<std::unique_ptr<worker>> shards_;
+        const std::uint32_t instruments_;
+        std::atomic<bool> stop_ = false;
+        std::uint64_t rejected_ = 0; // Events of unknown instruments, written by the producer only
+
+    public:
+        // Books of "capacity" levels for instruments 0 to "instruments" - 1, spread across "shards"
+        // worker threads. Worker i is pinned to CPU cpus[i], if given; failure to pin is not an error,
+        // see pinned(). Can throw book_type::bad_capacity.
+        sharded(std::size_t shards, std::uint32_t instruments, int capacity, std::size_t ring_size = 4096,
+                const std::vector<int>& cpus = {}, bool huge_pages = false)
+                : instruments_(instruments) {
+            shards = std::max<std::size_t>(shards, 1);
+            shards_.reserve(shards);
+            for (std::size_t i = 0; i < shards; ++i) {
+                const auto owned = i < instruments ? (instruments - i + shards - 1) / shards : 0;
+                auto& s = *shards_.emplace_back(std::make_unique<worker>(std::max<std::size_t>(owned, 1),
+                                                                        capacity, ring_size, huge_pages));
+                // Assign all books up-front, so that readers can look them up while workers are running
+                for (auto id = (std::uint32_t)i; id < instruments; id += (std::uint32_t)shards) {
+                    s.engine.books().acquire(id);
+                }
+            }
+            for (std::size_t i = 0; i < shards; ++i) {
+                auto& s = *shards_[i];
+                s.thread = std::thread([this, &s]() { work_(s); });
+                s.pinned = i < cpus.size() && common::pin(s.thread, cpus[i]);
+            }
+        }
+
+        sharded(const sharded& ) = delete;
+        sharded& operator=(const sharded& ) = delete;
+
+        // Applies all events posted so far, then stops the workers
+        ~sharded() {
+            stop_.store(true, std::memory_order_release);
+            for (auto& s : shards_) {
+                s->thread.join();
+            }
+        }
+
+        std::size_t shards() const { return shards_.size(); }
+        std::uint32_t instruments() const { return instruments_; }
+        std::size_t shard(std::uint32_t instrument) const { return instrument % shards_.size(); }
+        bool pinned(std::size_t shard) const { return shards_[shard]->pinned; }
+
+        // Producer API, must be called from a single thread only. Routes event to the shard of its
+        // instrument, returns false if its ring is full
+        bool try_post(const record& r) {
+            if (r.instrument >= instruments_) {
+                ++rejected_;
+                return true;
+            }
+            auto& s = *shards_[r.instrument % shards_.size()];
+            if (not s.ring.try_push(r)) {
+                return false;
+            }
+            ++s.posted;
+            return true;
+        }
+
+        // As try_post(), but waits while the ring is full
+        void post(const record& r) {
+            for (impl::backoff wait; not try_post(r);) {
+                wait();
+            }
+        }
+
+        // Producer API, wait until all events posted so far are applied
+        void flush() const {
+            for (const auto& s : shards_) {
+                for (impl::backoff wait; s->processed.load(std::memory_order_acquire) != s->posted;) {
+                    wait();
+                }
+            }
+        }
+
+        // Post events in range, wait until they are applied and measure the time taken. Reported
+        // events and dropped are totals since construction, as in stats().
+        replay::stats run(const record* first, const record* last) {
+            const auto start = std::chrono::steady_clock::now();
+            for (; first != last; ++first) {
+                post(*first);
+            }
+            flush();
+            const auto stop = std::chrono::steady_clock::now();
+            auto result = stats();
+            result.ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+            return result;
+        }
+
+        // Events processed and dropped by all workers so far, including events rejected by post()
+        replay::stats stats() const {
+            replay::stats result;
+            result.events = rejected_;
+            result.dropped = rejected_;
+            for (const auto& s : shards_) {
+                result.events += s->processed.load(std::memory_order_acquire);
+                result.dropped += s->dropped.load(std::memory_order_relaxed);
+            }
+            return result;
+        }
+
+        // Reader API, safe to call from any thread. Copies up to n levels from the top of the given
+        // Side of the book of instrument to out, returns the number of levels copied.
+        template <side Side>
+        std::size_t read(std::uint32_t instrument, level* out, std::size_t n) const {
+            const auto* const b = find_(instrument);
+            if (b == nullptr) {
+                return 0;
+            }
+            std::size_t result = 0;
+            lock_(instrument).read([&]() {
+                // Size and entries of "sides" can be torn while the worker is modifying the book, and
+                // must be bound checked before use, as in versioned::read
+                const std::size_t capacity = b->capacity;
+                const std::size_t size = b->template size<Side>();
+                result = std::min(n, std::min(size, capacity));
+                for (std::size_t i = 0; i < result; ++i) {
+                    const auto s = b->template slot<Side>((size_type)i);
+                    if (s >= capacity * 2) { // Only possible if the worker is in progress
+                        return false;
+                    }
+                    std::memcpy((void*)&out[i], (const void*)&b->get(s), sizeof(level));
+                }
+                return true;
+            });
+            return result;
+        }
+
+        // Sizes of both sides of the book of instrument, as a consistent pair
+        std::pair<size_type, size_type> sizes(std::uint32_t instrument) const {
+            const auto* const b = find_(instrument);
+            std::pair<size_type, size_type> result = {0, 0};
+            if (b != nullptr) {
+                lock_(instrument).read([&]() {
+                    result = std::make_pair(b->template size<side::bid>(), b->template size<side::ask>());
+                    return true;
+                });
+            }
+            return result;
+        }
+
+        // Book of instrument or nullptr. Only safe to use while no events are being applied, e.g. after
+        // flush() and before the next post()
+        const book_type* book(std::uint32_t instrument) const {
+            return find_(instrument);
+        }
+    };
+} // namespace market::replay
@@ -0,0 +1,87 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "shm.hpp"
+
+#include <cerrno>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace market::shm {
+    namespace {
+        [[noreturn]] void fail(const char* what, const std::string& name) {
+            throw std::system_error(errno, std::generic_category(), std::string(what) + " " + name);
+        }
+
+        // Closes the file descriptor on scope exit, the mapping remains valid after that
+        struct descriptor {
+            const int fd;
+            ~descriptor() { ::close(fd); }
+        };
+    }
+
+    segment::segment(std::string name, void* data, std::size_t size)
+        : name_(std::move(name))
+        , data_(data)
+        , size_(size)
+    { }
+
+    segment::segment(segment&& other) noexcept
+        : name_(std::move(other.name_))
+        , data_(std::exchange(other.data_, nullptr))
+        , size_(std::exchange(other.size_, 0))
+    { }
+
+    segment::~segment() {
+        if (data_ != nullptr) {
+            ::munmap(data_, size_);
+        }
+    }
+
+    segment segment::create(const std::string& name, std::size_t size) {
+        // Unlink any existing segment rather than truncate it, so its readers keep the old object
+        if (::shm_unlink(name.c_str()) != 0 && errno != ENOENT) {
+            fail("shm_unlink", name);
+        }
+        const descriptor f{::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644)};
+        if (f.fd < 0) {
+            fail("shm_open", name);
+        }
+        if (::ftruncate(f.fd, (off_t)size) != 0) {
+            fail("ftruncate", name);
+        }
+        void* const data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, f.fd, 0);
+        if (data == MAP_FAILED) {
+            fail("mmap", name);
+        }
+        return segment{name, data, size};
+    }
+
+    segment segment::open(const std::string& name) {
+        const descriptor f{::shm_open(name.c_str(), O_RDONLY, 0)};
+        if (f.fd < 0) {
+            fail("shm_open", name);
+        }
+        struct stat st = {};
+        if (::fstat(f.fd, &st) != 0) {
+            fail("fstat", name);
+        }
+        const auto size = (std::size_t)st.st_size;
+        void* const data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, f.fd, 0);
+        if (data == MAP_FAILED) {
+            fail("mmap", name);
+        }
+        return segment{name, data, size};
+    }
+
+    bool segment::remove(const std::string& name) noexcept {
+        return ::shm_unlink(name.c_str()) == 0;
+    }
+} // namespace market::shm
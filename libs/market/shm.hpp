@@ -0,0 +1,253 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "book.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace market::shm {
+    // POSIX shared memory segment, mapped in the address space of this process. Removal of the
+    // segment name (shm_unlink) is left to the creator, processes which have already mapped the
+    // segment can keep using it after that. Failures of system calls are reported as system_error.
+    class segment {
+        std::string name_;
+        void* data_ = nullptr;
+        std::size_t size_ = 0;
+
+        segment(std::string name, void* data, std::size_t size);
+
+    public:
+        // Create a new segment (replacing any existing one with the same name), mapped read-write
+        static segment create(const std::string& name, std::size_t size);
+        // Open an existing segment, mapped read-only
+        static segment open(const std::string& name);
+        // Remove segment name, returns false if it did not exist
+        static bool remove(const std::string& name) noexcept;
+
+        segment(segment&& other) noexcept;
+        segment& operator=(segment&& ) = delete;
+        ~segment();
+
+        const std::string& name() const { return name_; }
+        void* data() const { return data_; }
+        std::size_t size() const { return size_; }
+    };
+
+    // Layout of a segment: header, followed by "count" slots, each holding a single book:
+    //
+    //   slot header | levels[capacity * 2] | sides[capacity * 2] | freel[capacity * 2] | keys
+    //
+    // Every slot and every array in it starts at a multiple of 64 bytes. Array "keys" is only
+    // present for books using linear search mode.
+    struct header {
+        constexpr static std::uint64_t magic_value = 0x4b4f4f42544b4d; // "MKTBOOK"
+        constexpr static std::uint32_t version_value = 1;
+
+        std::uint64_t magic;
+        std::uint32_t version;
+        std::uint32_t count; // Number of slots
+        std::uint32_t capacity; // Capacity of each book
+        std::uint32_t level_size; // sizeof(Level)
+        std::uint32_t index_size; // sizeof(Index)
+        std::uint32_t key_size; // sizeof(key_type) or 0 in binary search mode
+        std::uint64_t stride; // Size of a single slot, in bytes
+    };
+
+    // Published state of a single book, which is the part of a book not stored in arrays. It is
+    // updated by writer::handle::commit() and read by reader::view()
+    struct slot_header {
+        std::uint32_t capacity;
+        std::uint32_t tail;
+        std::uint32_t size[2];
+    };
+
+    template <typename Level, typename Policy = Level, typename Index = uint8_t>
+    struct layout {
+        using book_type = market::book<Level, Policy, Index>;
+        using level = typename book_type::level;
+        using size_type = typename book_type::size_type;
+        using key_type = typename book_type::key_type;
+        static_assert(std::is_trivially_copyable_v<level>);
+        // Array "totals" is not stored in a segment
+        static_assert(not book_type::cumulative, "cumulative totals are not supported");
+
+        constexpr static std::size_t align(std::size_t n) { return (n + 63) & ~(std::size_t)63; }
+
+        const std::size_t capacity;
+        const std::size_t levels = align(sizeof(slot_header));
+        const std::size_t sides = levels + align(sizeof(level) * capacity * 2);
+        const std::size_t freel = sides + align(sizeof(size_type) * capacity * 2);
+        const std::size_t keys = freel + align(sizeof(size_type) * capacity * 2);
+        const std::size_t stride = keys + (book_type::linear ? align(sizeof(key_type) * capacity * 2) : 0);
+
+        constexpr static std::size_t first = (sizeof(header) + 63) & ~(std::size_t)63;
+
+        constexpr std::size_t size(std::size_t count) const { return first + stride * count; }
+
+        header make(std::size_t count) const {
+            return header{header::magic_value, header::version_value, (std::uint32_t)count,
+                          (std::uint32_t)capacity, sizeof(level), sizeof(size_type),
+                          book_type::linear ? (std::uint32_t)sizeof(key_type) : 0u, stride};
+        }
+    };
+
+    // Owner of a segment, which maintains all the books stored in it
+    template <typename Level, typename Policy = Level, typename Index = uint8_t>
+    class writer {
+        using layout_type = layout<Level, Policy, Index>;
+
+    public:
+        using book_type = market::book<Level, Policy, Index>;
+        using level = typename book_type::level;
+        using size_type = typename book_type::size_type;
+
+        // Book stored in a slot of the segment. Changes made to it are visible to readers only after
+        // commit(), which publishes sizes of both sides.
+        struct handle : book_type {
+            handle(std::byte* slot, const layout_type& l)
+                    : book_type(reinterpret_cast<level*>(slot + l.levels),
+                                reinterpret_cast<size_type*>(slot + l.sides),
+                                reinterpret_cast<size_type*>(slot + l.freel),
+                                (int)l.capacity, 0, 0)
+                    , header(reinterpret_cast<slot_header*>(slot)) {
+                if constexpr (book_type::linear) {
+                    this->keys = reinterpret_cast<typename book_type::key_type*>(slot + l.keys);
+                }
+                header->capacity = this->capacity;
+                reset();
+            }
+
+            void reset() {
+                book_type::reset();
+                commit();
+            }
+
+            void commit() {
+                std::atomic_ref<std::uint32_t>(header->tail).store(this->tail_i, std::memory_order_relaxed);
+                std::atomic_ref<std::uint32_t>(header->size[0]).store(this->side_i[0], std::memory_order_release);
+                std::atomic_ref<std::uint32_t>(header->size[1]).store(this->side_i[1], std::memory_order_release);
+            }
+
+        private:
+            slot_header* header;
+        };
+
+        writer(const std::string& name, std::size_t count, int capacity)
+                : layout_{check(capacity)}
+                , segment_(segment::create(name, layout_.size(count))) {
+            auto* const base = static_cast<std::byte*>(segment_.data());
+            *reinterpret_cast<header*>(base) = layout_.make(count);
+            books_.reserve(count);
+            for (std::size_t i = 0; i < count; ++i) {
+                books_.emplace_back(base + layout_.first + layout_.stride * i, layout_);
+            }
+        }
+
+        ~writer() {
+            segment::remove(segment_.name());
+        }
+
+        std::size_t size() const { return books_.size(); }
+        handle& operator[](std::size_t i) { return books_[i]; }
+        const handle& operator[](std::size_t i) const { return books_[i]; }
+
+        void commit() {
+            for (auto& b : books_) {
+                b.commit();
+            }
+        }
+
+    private:
+        static std::size_t check(int capacity) {
+            if (capacity < 0 || capacity > book_type::max_capacity) {
+                throw typename book_type::bad_capacity(capacity);
+            }
+            return (std::size_t)capacity;
+        }
+
+        const layout_type layout_;
+        segment segment_;
+        std::vector<handle> books_;
+    };
+
+    // Maps an existing segment read-only and provides immutable views of the books stored in it
+    template <typename Level, typename Policy = Level, typename Index = uint8_t>
+    class reader {
+        using layout_type = layout<Level, Policy, Index>;
+
+    public:
+        using book_type = market::book<Level, Policy, Index>;
+        using level = typename book_type::level;
+        using size_type = typename book_type::size_type;
+
+        // Thrown if the segment was created for a different type of book
+        struct bad_layout : std::runtime_error {
+            explicit bad_layout(const std::string& name)
+                : std::runtime_error("invalid layout of market book segment " + name)
+            { }
+        };
+
+        // Immutable book, referring directly to arrays stored in the segment
+        struct view : book_type {
+            view(const std::byte* slot, const layout_type& l, size_type b, size_type a)
+                    : book_type(reinterpret_cast<const level*>(slot + l.levels),
+                                reinterpret_cast<const size_type*>(slot + l.sides),
+                                (int)l.capacity, b, a, book_type::nothrow) {
+                if constexpr (book_type::linear) {
+                    this->keys = const_cast<typename book_type::key_type*>(
+                            reinterpret_cast<const typename book_type::key_type*>(slot + l.keys));
+                }
+            }
+        };
+
+        explicit reader(const std::string& name)
+                : segment_(segment::open(name))
+                , layout_{validate(segment_)} {
+        }
+
+        std::size_t size() const { return count_; }
+
+        // Snapshot of the sizes published by the writer. Note, the writer may be modifying the book
+        // at the same time, which must be prevented by the user e.g. with a sequence lock.
+        view operator[](std::size_t i) const {
+            const auto* slot = base() + layout_.first + layout_.stride * i;
+            auto* const h = const_cast<slot_header*>(reinterpret_cast<const slot_header*>(slot));
+            const auto b = std::atomic_ref<std::uint32_t>(h->size[0]).load(std::memory_order_acquire);
+            const auto a = std::atomic_ref<std::uint32_t>(h->size[1]).load(std::memory_order_acquire);
+            return view(slot, layout_, (size_type)b, (size_type)a);
+        }
+
+    private:
+        const std::byte* base() const { return static_cast<const std::byte*>(segment_.data()); }
+
+        std::size_t validate(const segment& s) {
+            if (s.size() < sizeof(header)) {
+                throw bad_layout(s.name());
+            }
+            const auto& h = *static_cast<const header*>(s.data());
+            const layout_type expected{h.capacity};
+            const auto e = expected.make(h.count);
+            if (h.magic != e.magic || h.version != e.version || h.capacity > (std::uint32_t)book_type::max_capacity
+                || h.level_size != e.level_size || h.index_size != e.index_size || h.key_size != e.key_size
+                || h.stride != e.stride || s.size() < expected.size(h.count)) {
+                throw bad_layout(s.name());
+            }
+            count_ = h.count;
+            return h.capacity;
+        }
+
+        segment segment_;
+        std::size_t count_ = 0;
+        const layout_type layout_;
+    };
+} // namespace market::shm
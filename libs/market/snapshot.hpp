@@ -0,0 +1,191 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "book.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace market::snapshot {
+    // Contiguous binary snapshot of a book, in native byte order:
+    //
+    //   header | levels[size[0] + size[1]] | sides[capacity * 2] | keys[capacity * 2]
+    //
+    // Levels are stored compacted, bid side first, so the capacity of a snapshot is the size of the
+    // larger side (or the capacity of the book, if fixed at compile time). Every array starts at a
+    // multiple of "alignment" (see layout below) from the beginning of the snapshot, and array "keys"
+    // is only present for books using linear search mode.
+    struct header {
+        constexpr static std::uint64_t magic_value = 0x50414e53544b4d; // "MKTSNAP"
+        constexpr static std::uint32_t version_value = 1;
+
+        std::uint64_t magic;
+        std::uint32_t version;
+        std::uint32_t capacity; // Capacity of the snapshot, i.e. max(size[0], size[1]) or Capacity
+        std::uint32_t size[2]; // Number of levels on each side
+        std::uint32_t level_size; // sizeof(Level)
+        std::uint16_t index_size; // sizeof(Index)
+        std::uint16_t key_size; // sizeof(key_type) or 0 in binary search mode
+        std::uint64_t bytes; // Size of the snapshot, including this header
+    };
+
+    // Thrown if a buffer does not contain a valid snapshot of the requested type of book, or is
+    // too small to store a snapshot
+    struct bad_snapshot : std::runtime_error {
+        explicit bad_snapshot(const std::string& what)
+            : std::runtime_error("invalid market book snapshot, " + what)
+        { }
+    };
+
+    // If Capacity is not 0, the snapshot is of a book with fixed capacity and both sides are stored
+    // with that capacity, rather than the larger of their sizes
+    template <typename Level, typename Policy = Level, typename Index = uint8_t, int Capacity = 0>
+    struct layout {
+        using book_type = market::book<Level, Policy, Index, Capacity>;
+        using level = typename book_type::level;
+        using size_type = typename book_type::size_type;
+        using key_type = typename book_type::key_type;
+        static_assert(std::is_trivially_copyable_v<level>);
+        // Array "totals" is not stored in a snapshot
+        static_assert(not book_type::cumulative, "cumulative totals are not supported");
+
+        // Required alignment of the buffer holding a snapshot
+        constexpr static std::size_t alignment = std::max<std::size_t>({alignof(header), alignof(level), 8});
+        constexpr static std::size_t align(std::size_t n) { return (n + alignment - 1) & ~(alignment - 1); }
+
+        const std::size_t capacity;
+        const std::size_t count; // Number of levels
+        const std::size_t levels = align(sizeof(header));
+        const std::size_t sides = levels + align(sizeof(level) * count);
+        const std::size_t keys = sides + align(sizeof(size_type) * capacity * 2);
+        const std::size_t bytes = keys + (book_type::linear ? sizeof(key_type) * capacity * 2 : 0);
+
+        header make(std::size_t bid, std::size_t ask) const {
+            return header{header::magic_value, header::version_value, (std::uint32_t)capacity,
+                          {(std::uint32_t)bid, (std::uint32_t)ask}, sizeof(level), sizeof(size_type),
+                          book_type::linear ? (std::uint16_t)sizeof(key_type) : (std::uint16_t)0u, bytes};
+        }
+
+        static layout from(std::size_t bid, std::size_t ask) {
+            return layout{Capacity != 0 ? (std::size_t)Capacity : std::max(bid, ask), bid + ask};
+        }
+    };
+
+    // Number of bytes required to store snapshot of the book
+    template <typename Level, typename Policy, typename Index, int Capacity>
+    std::size_t size(const book<Level, Policy, Index, Capacity>& b) {
+        return layout<Level, Policy, Index, Capacity>::from(b.template size<side::bid>(), b.template size<side::ask>()).bytes;
+    }
+
+    // Store snapshot of the book in the buffer, which must be aligned to layout::alignment. Returns
+    // the number of bytes written, throws bad_snapshot if the buffer is too small
+    template <typename Level, typename Policy, typename Index, int Capacity>
+    std::size_t write(const book<Level, Policy, Index, Capacity>& b, void* buffer, std::size_t size) {
+        using layout_type = layout<Level, Policy, Index, Capacity>;
+        using size_type = typename layout_type::size_type;
+        using key_type = typename layout_type::key_type;
+        const auto l = layout_type::from(b.template size<side::bid>(), b.template size<side::ask>());
+        if (size < l.bytes) {
+            throw bad_snapshot("buffer too small");
+        }
+
+        auto* const base = static_cast<std::byte*>(buffer);
+        const header h = l.make(b.template size<side::bid>(), b.template size<side::ask>());
+        std::memcpy(base, &h, sizeof(header));
+        auto* const levels = reinterpret_cast<typename layout_type::level*>(base + l.levels);
+        auto* const sides = reinterpret_cast<size_type*>(base + l.sides);
+        auto* const keys = reinterpret_cast<key_type*>(base + l.keys);
+        std::memset(sides, 0, sizeof(size_type) * l.capacity * 2);
+
+        std::size_t o = 0;
+        auto copy = [&]<side Side>() {
+            const std::size_t s = (std::size_t)Side * l.capacity;
+            for (size_type i = 0; i < b.template size<Side>(); ++i, ++o) {
+                const auto& v = b.template at<Side>(i);
+                std::memcpy((void*)&levels[o], (const void*)&v, sizeof(v));
+                sides[s + i] = (size_type)o;
+                if constexpr (layout_type::book_type::linear) {
+                    keys[s + i] = (key_type)Policy::template key<Side>(v);
+                }
+            }
+            if constexpr (layout_type::book_type::linear) {
+                std::fill(keys + s + b.template size<Side>(), keys + s + l.capacity, (key_type)0);
+            }
+        };
+        copy.template operator()<side::bid>();
+        copy.template operator()<side::ask>();
+        return l.bytes;
+    }
+
+    // Immutable book, referring directly to the arrays stored in a snapshot. The buffer must remain
+    // valid for as long as the view is used.
+    template <typename Level, typename Policy = Level, typename Index = uint8_t, int Capacity = 0>
+    struct view : book<Level, Policy, Index, Capacity> {
+        using layout_type = layout<Level, Policy, Index, Capacity>;
+        using book_type = typename layout_type::book_type;
+        using level = typename layout_type::level;
+        using size_type = typename layout_type::size_type;
+        using key_type = typename layout_type::key_type;
+
+        view(const void* buffer, std::size_t size)
+                : view(static_cast<const std::byte*>(buffer), validate(buffer, size))
+        { }
+
+    private:
+        view(const std::byte* base, const header& h)
+                : book_type(reinterpret_cast<const level*>(base + layout_type::from(h.size[0], h.size[1]).levels),
+                            reinterpret_cast<const size_type*>(base + layout_type::from(h.size[0], h.size[1]).sides),
+                            (int)h.capacity, (size_type)h.size[0], (size_type)h.size[1], book_type::nothrow) {
+            if constexpr (book_type::linear) {
+                this->keys = const_cast<key_type*>(reinterpret_cast<const key_type*>(
+                        base + layout_type::from(h.size[0], h.size[1]).keys));
+            }
+        }
+
+        static const header& validate(const void* buffer, std::size_t size) {
+            if (reinterpret_cast<std::uintptr_t>(buffer) % layout_type::alignment != 0) {
+                throw bad_snapshot("misaligned buffer");
+            }
+            if (size < sizeof(header)) {
+                throw bad_snapshot("buffer too small");
+            }
+            const auto& h = *static_cast<const header*>(buffer);
+            if (h.magic != header::magic_value || h.version != header::version_value) {
+                throw bad_snapshot("unknown format");
+            }
+            constexpr auto max_size = (std::uint32_t)(Capacity != 0 ? Capacity : book_type::max_capacity);
+            if (h.size[0] > max_size || h.size[1] > max_size) {
+                throw bad_snapshot("too many levels");
+            }
+            const auto l = layout_type::from(h.size[0], h.size[1]);
+            const auto e = l.make(h.size[0], h.size[1]);
+            if (h.capacity != e.capacity || h.level_size != e.level_size || h.index_size != e.index_size
+                || h.key_size != e.key_size || h.bytes != e.bytes) {
+                throw bad_snapshot("layout mismatch");
+            }
+            if (size < l.bytes) {
+                throw bad_snapshot("buffer too small");
+            }
+
+            // Indices in "sides" are used to access levels, must not point outside of the snapshot
+            const auto* const sides = reinterpret_cast<const size_type*>(static_cast<const std::byte*>(buffer) + l.sides);
+            for (std::size_t s = 0; s < 2; ++s) {
+                for (std::size_t i = 0; i < h.size[s]; ++i) {
+                    if (sides[s * l.capacity + i] >= l.count) {
+                        throw bad_snapshot("level index out of range");
+                    }
+                }
+            }
+            return h;
+        }
+    };
+} // namespace market::snapshot
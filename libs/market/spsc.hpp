@@ -0,0 +1,111 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "market.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+
+namespace market {
+    // Bounded lock-free ring buffer for a single producer thread and a single consumer thread.
+    // Capacity is rounded up to a power of two and the storage is allocated once, on construction.
+    // Each side keeps a cached copy of the position of the other side, and only reloads it (i.e. only
+    // touches the cache line written by the other thread) when the ring appears full or empty.
+    template <typename Type>
+    class spsc {
+        static_assert(std::is_trivially_copyable_v<Type>);
+
+        // Written by producer
+        alignas(64) std::atomic<std::uint64_t> tail_ = 0;
+        std::uint64_t head_cache_ = 0;
+        // Written by consumer
+        alignas(64) std::atomic<std::uint64_t> head_ = 0;
+        std::uint64_t tail_cache_ = 0;
+
+        alignas(64) const std::size_t mask_;
+        const std::unique_ptr<Type[]> data_;
+
+        static std::size_t check(std::size_t capacity) {
+            if (capacity == 0 || capacity > ((std::size_t)1 << 40)) {
+                throw std::length_error("invalid capacity of spsc ring");
+            }
+            return std::bit_ceil(capacity) - 1;
+        }
+
+    public:
+        explicit spsc(std::size_t capacity)
+                : mask_(check(capacity))
+                , data_(new Type[mask_ + 1]) {
+        }
+
+        spsc(const spsc& ) = delete;
+        spsc& operator=(const spsc& ) = delete;
+
+        std::size_t capacity() const noexcept { return mask_ + 1; }
+
+        // Approximate number of elements, exact if called when neither side is active. Loads head
+        // before tail, since both only grow and head never passes tail, so the difference cannot wrap
+        std::size_t size() const noexcept {
+            const auto h = head_.load(std::memory_order_acquire);
+            return (std::size_t)(tail_.load(std::memory_order_acquire) - h);
+        }
+
+        bool empty() const noexcept { return size() == 0; }
+
+        // Producer API. Returns false if the ring is full
+        bool try_push(const Type& v) noexcept {
+            const auto t = tail_.load(std::memory_order_relaxed);
+            if (t - head_cache_ > mask_) {
+                head_cache_ = head_.load(std::memory_order_acquire);
+                if (t - head_cache_ > mask_) {
+                    return false;
+                }
+            }
+            data_[t & mask_] = v;
+            tail_.store(t + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer API. Returns false if the ring is empty
+        bool try_pop(Type& v) noexcept {
+            const auto h = head_.load(std::memory_order_relaxed);
+            if (h == tail_cache_) {
+                tail_cache_ = tail_.load(std::memory_order_acquire);
+                if (h == tail_cache_) {
+                    return false;
+                }
+            }
+            v = data_[h & mask_];
+            head_.store(h + 1, std::memory_order_release);
+            return true;
+        }
+
+        // Consumer API. Call fn(const Type&) for at most n elements available, in order, and release
+        // them to the producer all at once. Returns the number of elements consumed.
+        template <typename Fn>
+        std::size_t consume(Fn&& fn, std::size_t n) {
+            const auto h = head_.load(std::memory_order_relaxed);
+            if (tail_cache_ - h < n) {
+                tail_cache_ = tail_.load(std::memory_order_acquire);
+            }
+            const auto count = (std::size_t)std::min<std::uint64_t>(tail_cache_ - h, n);
+            for (std::size_t i = 0; i < count; ++i) {
+                fn(static_cast<const Type&>(data_[(h + i) & mask_]));
+            }
+            if (count > 0) {
+                head_.store(h + count, std::memory_order_release);
+            }
+            return count;
+        }
+    };
+} // namespace market
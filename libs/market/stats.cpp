@@ -0,0 +1,56 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "stats.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <ostream>
+
+namespace market {
+    namespace {
+        constexpr const char* names[metric_count] = {"compare", "shift", "pop", "push", "reject", "search", "sort"};
+
+        void row(std::ostream& out, const std::string& name, std::size_t width, const counters& c) {
+            out << std::left << std::setw((int)width) << name << std::right;
+            for (std::size_t i = 0; i < metric_count; ++i) {
+                out << std::setw(14) << c.values[i];
+            }
+            out << '\n';
+        }
+    }
+
+    const char* name(metric m) noexcept {
+        return (std::size_t)m < metric_count ? names[(std::size_t)m] : "unknown";
+    }
+
+    void stats::add(std::string name, const counters& c) {
+        entries_.emplace_back(std::move(name), &c);
+    }
+
+    counters stats::total() const {
+        counters result;
+        for (const auto& e : entries_) {
+            result += *e.second;
+        }
+        return result;
+    }
+
+    void stats::dump(std::ostream& out) const {
+        std::size_t width = 6; // Length of "total", with a space
+        for (const auto& e : entries_) {
+            width = std::max(width, e.first.size() + 1);
+        }
+        out << std::left << std::setw((int)width) << "book" << std::right;
+        for (const auto* n : names) {
+            out << std::setw(14) << n;
+        }
+        out << '\n';
+        for (const auto& e : entries_) {
+            row(out, e.first, width, *e.second);
+        }
+        row(out, "total", width, total());
+    }
+} // namespace market
@@ -0,0 +1,43 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "market.hpp"
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace market {
+    // Name of the metric, as printed by stats::dump()
+    const char* name(metric m) noexcept;
+
+    // Aggregator of counters of instrumented books (see book::stats()), registered under names such
+    // as instrument symbols. Only pointers to counters are stored, so dump() prints current values,
+    // and registered books must outlive this object (or until clear() is called).
+    class stats {
+        std::vector<std::pair<std::string, const counters*>> entries_;
+
+    public:
+        void add(std::string name, const counters& c);
+
+        template <typename Book>
+        void add(std::string name, const Book& book) {
+            add(std::move(name), book.stats());
+        }
+
+        std::size_t size() const { return entries_.size(); }
+        void clear() { entries_.clear(); }
+
+        // Sum of counters of all registered books
+        counters total() const;
+
+        // Print a table with one row for each book, in the order of registration, followed by totals
+        void dump(std::ostream& out) const;
+    };
+} // namespace market
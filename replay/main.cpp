@@ -0,0 +1,150 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "market/sharded.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <vector>
+
+namespace {
+    int usage(const char* self) {
+        std::fprintf(stderr,
+                     "usage: %s [options] FILE\n"
+                     "  --capacity N     capacity of each book, default 127\n"
+                     "  --huge-pages     allocate books in huge pages, if available\n"
+                     "  --repeat N       number of replays, fastest is reported, default 1\n"
+                     "  --shards N       apply events on N worker threads, one shard of instruments each\n"
+                     "  --cpus A,B,...   pin worker threads to these CPUs, used with --shards\n"
+                     "       %s --generate FILE [options]\n"
+                     "  --events N       number of events to generate, default 10000000\n"
+                     "  --instruments N  number of instruments, default 1000\n"
+                     "  --seed N         seed of random number generator, default 1\n",
+                     self, self);
+        return 2;
+    }
+
+    int generate(const std::string& path, std::size_t events, std::uint32_t instruments, std::uint64_t seed) {
+        const auto records = market::replay::generate(events, instruments, seed);
+        market::replay::write(path, records.data(), records.data() + records.size());
+        std::printf("%zu events for %u instruments written to %s\n", records.size(), instruments, path.c_str());
+        return 0;
+    }
+
+    int replay(const std::string& path, int capacity, bool huge_pages, int repeat) {
+        using engine_t = market::replay::engine<>;
+        const market::replay::file f(path);
+        // Fits, since ids not smaller than record::max_instruments are ignored
+        const auto instruments = (std::uint32_t)market::replay::instruments(f.begin(), f.end());
+
+        market::replay::stats best;
+        std::uint64_t checksum = 0;
+        for (int i = 0; i < std::max(repeat, 1); ++i) {
+            engine_t engine(instruments, capacity, huge_pages);
+            engine.prepare(f.begin(), f.end());
+            const auto s = engine.run(f.begin(), f.end());
+            if (i == 0 || s.ns < best.ns) {
+                best = s;
+            }
+            checksum = engine.checksum();
+            if (i == 0) {
+                std::printf("%u instruments, huge pages %s\n", instruments,
+                            engine.books().memory().huge() ? "yes" : "no");
+            }
+        }
+        std::printf("%llu events, %llu dropped, %.3f s, %.0f events/sec, checksum %016llx\n",
+                    (unsigned long long)best.events, (unsigned long long)best.dropped, best.ns / 1e9,
+                    best.events_per_sec(), (unsigned long long)checksum);
+        return 0;
+    }
+
+    int replay_sharded(const std::string& path, int capacity, bool huge_pages, int repeat, std::size_t shards,
+                       const std::vector<int>& cpus) {
+        using sharded_t = market::replay::sharded<>;
+        const market::replay::file f(path);
+        const auto instruments = (std::uint32_t)market::replay::instruments(f.begin(), f.end());
+
+        market::replay::stats best;
+        for (int i = 0; i < std::max(repeat, 1); ++i) {
+            sharded_t books(shards, instruments, capacity, 4096, cpus, huge_pages);
+            const auto s = books.run(f.begin(), f.end());
+            if (i == 0 || s.ns < best.ns) {
+                best = s;
+            }
+            if (i == 0) {
+                std::size_t pinned = 0;
+                for (std::size_t j = 0; j < books.shards(); ++j) {
+                    pinned += (std::size_t)books.pinned(j);
+                }
+                std::printf("%u instruments, %zu shards, %zu pinned\n", instruments, books.shards(), pinned);
+            }
+        }
+        std::printf("%llu events, %llu dropped, %.3f s, %.0f events/sec\n",
+                    (unsigned long long)best.events, (unsigned long long)best.dropped, best.ns / 1e9,
+                    best.events_per_sec());
+        return 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string path;
+    bool gen = false;
+    bool huge_pages = false;
+    int capacity = 127;
+    int repeat = 1;
+    std::size_t shards = 0;
+    std::vector<int> cpus;
+    std::size_t events = 10000000;
+    std::uint32_t instruments = 1000;
+    std::uint64_t seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--generate") {
+            gen = true;
+        } else if (arg == "--capacity" && i + 1 < argc) {
+            capacity = std::atoi(argv[++i]);
+        } else if (arg == "--huge-pages") {
+            huge_pages = true;
+        } else if (arg == "--repeat" && i + 1 < argc) {
+            repeat = std::atoi(argv[++i]);
+        } else if (arg == "--shards" && i + 1 < argc) {
+            shards = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--cpus" && i + 1 < argc) {
+            const std::string list = argv[++i];
+            for (std::size_t b = 0; b <= list.size();) {
+                const auto e = std::min(list.find(',', b), list.size());
+                cpus.push_back(std::atoi(list.substr(b, e - b).c_str()));
+                b = e + 1;
+            }
+        } else if (arg == "--events" && i + 1 < argc) {
+            events = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--instruments" && i + 1 < argc) {
+            instruments = (std::uint32_t)std::strtoul(argv[++i], nullptr, 10);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (not arg.empty() && arg[0] != '-' && path.empty()) {
+            path = arg;
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (path.empty()) {
+        return usage(argv[0]);
+    }
+
+    try {
+        if (gen) {
+            return generate(path, events, instruments, seed);
+        }
+        return shards > 0 ? replay_sharded(path, capacity, huge_pages, repeat, shards, cpus)
+                          : replay(path, capacity, huge_pages, repeat);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,145 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "assert.hpp"
+
+#include "market/arena.hpp"
+#include "level.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+
+namespace {
+    using tests::Level;
+    using tests::LinearPolicy;
+    using tests::CumulativePolicy;
+}
+
+TEST_CASE("Arena_slots", "[arena][acquire][release][find][reset]") {
+    using namespace market;
+    using arena_t = arena<Level>;
+    arena_t a(3, 5);
+    REQUIRE(a.size() == 3);
+    REQUIRE(a.used() == 0);
+    CHECK(a.memory().size() >= 3 * 64 * 2);
+    CHECK(a.find(0) == nullptr);
+    CHECK(a.owner(0) == arena_t::npos);
+
+    auto* const b1 = a.acquire(20000);
+    auto* const b2 = a.acquire(7);
+    REQUIRE(b1 != nullptr);
+    REQUIRE(b2 != nullptr);
+    CHECK(b1 != b2);
+    CHECK(a.acquire(20000) == b1);
+    // Sparse ids are rejected, rather than growing the array of slots
+    CHECK(a.acquire(arena_t::max_ids) == nullptr);
+    CHECK(a.acquire(4000000000u) == nullptr);
+    CHECK(a.find(4000000000u) == nullptr);
+    CHECK(a.find(7) == b2);
+    CHECK(&a[7] == b2);
+    CHECK(a.find(8) == nullptr);
+    CHECK(a.owner(0) == 20000);
+    CHECK(a.owner(1) == 7);
+    CHECK(a.used() == 2);
+    CHECK(b1->capacity == 5);
+
+    // Books are stored in the arena, next to each other
+    const auto* const base = static_cast<const std::byte*>(a.memory().data());
+    b1->insert<side::bid>(Level{100, 1});
+    b1->insert<side::ask>(Level{101, 2});
+    b2->insert<side::ask>(Level{102, 3});
+    CHECK((const std::byte*)&b1->at<side::bid>(0) >= base);
+    CHECK((const std::byte*)&b1->at<side::bid>(0) - base < 64 * 2);
+    CHECK((const std::byte*)&b2->at<side::ask>(0) - base >= 64 * 2);
+    CHECK(&b1->get(b1->slot<side::ask>(0)) == &b1->at<side::ask>(0));
+    CHECK(b2->slot<side::ask>(0) < 5 * 2);
+
+    SECTION("release and reuse slot") {
+        CHECK(a.acquire(3) != nullptr);
+        CHECK(a.acquire(4) == nullptr);
+        CHECK(a.used() == 3);
+        CHECK(a.release(20000));
+        CHECK(not a.release(20000));
+        CHECK(not a.release(5));
+        CHECK(a.find(20000) == nullptr);
+        auto* const b3 = a.acquire(4);
+        CHECK(b3 == b1);
+        CHECK(a.owner(0) == 4);
+        CHECK(b3->empty<side::bid>());
+        CHECK(b3->empty<side::ask>());
+    }
+
+    SECTION("bulk reset") {
+        a.reset();
+        CHECK(a.used() == 2);
+        CHECK(a.find(20000) == b1);
+        CHECK(b1->empty<side::bid>());
+        CHECK(b1->empty<side::ask>());
+        CHECK(b2->empty<side::ask>());
+        CHECK(b1->insert<side::bid>(Level{100, 1}) == 0);
+    }
+
+    SECTION("for_each") {
+        std::uint64_t ids = 0;
+        int levels = 0;
+        a.for_each([&](arena_t::id_type id, arena_t::handle& b) {
+            ids += id;
+            levels += b.size<side::bid>() + b.size<side::ask>();
+        });
+        CHECK(ids == 20007);
+        CHECK(levels == 3);
+    }
+}
+
+TEST_CASE("Arena_cumulative", "[arena][acquire][cumulative]") {
+    using namespace market;
+    using arena_t = arena<Level, CumulativePolicy>;
+    arena_t a(2, 5);
+    auto* const b1 = a.acquire(1);
+    auto* const b2 = a.acquire(2);
+    REQUIRE(b1 != nullptr);
+    REQUIRE(b2 != nullptr);
+    b1->insert<side::ask>(Level{101, 2});
+    b1->insert<side::ask>(Level{100, 1});
+    b2->insert<side::ask>(Level{100, 7});
+    CHECK(b1->depth<side::ask>(2).quantity == 3);
+    CHECK(b1->depth<side::ask>(2).notional == 100 + 202);
+    CHECK(b2->depth<side::ask>(1).quantity == 7);
+    a.release(1);
+    CHECK(a.acquire(3)->depth<side::ask>(0).quantity == 0);
+}
+
+TEST_CASE("Arena_construction", "[arena][capacity][bad_capacity][linear]") {
+    using namespace market;
+    using arena_t = arena<Level>;
+    using linear_t = arena<Level, LinearPolicy, uint16_t>;
+    CHECK_THROWS_AS(arena_t(1, 128), arena_t::book_type::bad_capacity);
+    CHECK_THROWS_AS(arena_t(1, 0), arena_t::book_type::bad_capacity);
+
+    SECTION("empty") {
+        arena_t a(0, 10);
+        CHECK(a.size() == 0);
+        CHECK(a.memory().data() == nullptr);
+        CHECK(a.acquire(0) == nullptr);
+    }
+
+    SECTION("huge pages requested") {
+        // Falls back to regular pages if no huge pages are available
+        linear_t a(1000, 200, true);
+        // Each slot holds 400 levels, 2 * 400 indices and 400 keys
+        CHECK(a.memory().size() >= 1000 * (400 * 8 + 2 * 400 * 2 + 400 * 4));
+        for (linear_t::id_type id = 0; id < 1000; ++id) {
+            auto* const b = a.acquire(id * 3);
+            REQUIRE(b != nullptr);
+            for (int i = 0; i < 200; ++i) {
+                b->emplace<side::ask>(1000 + (i * 7) % 200, i);
+            }
+        }
+        CHECK(a.acquire(1) == nullptr);
+        CHECK(a[2997].binary_search<side::ask>(1199) == 199);
+        CHECK(a[0].lower_bound<side::ask>(1100) == 100);
+    }
+}
@@ -0,0 +1,12 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+// Custom ASSERT, throwing so that failed preconditions can be tested. Must be included first in every
+// test file, because templates instantiated with the same arguments in different files must see the
+// same definition
+struct assert_error {};
+#define ASSERT(...) do { if((__VA_ARGS__) == 0) throw assert_error{}; } while(0)
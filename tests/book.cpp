@@ -3,71 +3,25 @@
 // Distributed under the MIT License. See accompanying file LICENSE
 // or copy at https://opensource.org/licenses/MIT
 
-struct assert_error {};
-#define ASSERT(...) do { if((__VA_ARGS__) == 0) throw assert_error{}; } while(0)
+#include "assert.hpp"
 
 #include "market/book.hpp"
+#include "level.hpp"
 
 #include <catch2/catch.hpp>
 
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <ranges>
 #include <set>
+#include <span>
 #include <vector>
 
 namespace {
-    struct Level {
-        int ticks = -1; int size = -1;
-
-        template <market::side Side>
-        constexpr static bool compare(const Level& lh, const Level& rh) noexcept;
-
-        template <market::side Side>
-        constexpr static bool compare(int, const Level& rh) noexcept;
-
-        template <market::side Side>
-        constexpr static bool compare(const Level& lh, int) noexcept;
-
-        constexpr static int make(int i) {
-            return i;
-        }
-    };
-
-    template <>
-    constexpr bool Level::compare<market::side::bid>(const Level& lh, const Level& rh) noexcept {
-        return lh.ticks > rh.ticks;
-    }
-
-    template <>
-    constexpr bool Level::compare<market::side::bid>(int lh, const Level& rh) noexcept {
-        return lh > rh.ticks;
-    }
-
-    template <>
-    constexpr bool Level::compare<market::side::bid>(const Level& lh, int rh) noexcept {
-        return lh.ticks > rh;
-    }
-
-    template <>
-    constexpr bool Level::compare<market::side::ask>(const Level& lh, const Level& rh) noexcept {
-        return lh.ticks < rh.ticks;
-    }
-
-    template <>
-    constexpr bool Level::compare<market::side::ask>(int lh, const Level& rh) noexcept {
-        return lh < rh.ticks;
-    }
-
-    template <>
-    constexpr bool Level::compare<market::side::ask>(const Level& lh, int rh) noexcept {
-        return lh.ticks < rh;
-    }
-
-    bool operator==(const Level& lh, const Level& rh) {
-        return lh.ticks == rh.ticks && lh.size == rh.size;
-    }
-
-    std::ostream& operator<<(std::ostream& lh, const Level& rh) {
-        return (lh << '{' << rh.ticks << ',' << rh.size << '}');
-    }
+    using tests::Level;
+    using tests::LinearPolicy;
+    using tests::CumulativePolicy;
 
     struct SmallBook : market::book<Level> {
         SmallBook() : book<Level>(data, 0, 0) {
@@ -618,6 +572,10 @@ TEST_CASE("AnySizeBook_construction", "[book][capacity][construction][bad_capaci
             CHECK_THROWS_AS(ptr->push_back<side::ask>(Level{}), assert_error);
             CHECK_THROWS_AS(ptr->emplace_back<side::bid>(1, 1), assert_error);
             CHECK_THROWS_AS(ptr->emplace_back<side::ask>(1, 1), assert_error);
+            CHECK_THROWS_AS(ptr->insert<side::bid>(Level{}), assert_error);
+            CHECK_THROWS_AS(ptr->insert<side::ask>(Level{}), assert_error);
+            CHECK_THROWS_AS(ptr->emplace<side::bid>(1, 1), assert_error);
+            CHECK_THROWS_AS(ptr->emplace<side::ask>(1, 1), assert_error);
             CHECK_THROWS_AS(ptr->remove<side::bid>(0), assert_error);
             CHECK_THROWS_AS(ptr->remove<side::ask>(0), assert_error);
         }
@@ -628,6 +586,10 @@ TEST_CASE("AnySizeBook_construction", "[book][capacity][construction][bad_capaci
             CHECK_THROWS_AS(ptr->push_back<side::ask>(Level{}), assert_error);
             CHECK_THROWS_AS(ptr->emplace_back<side::bid>(1, 1), assert_error);
             CHECK_THROWS_AS(ptr->emplace_back<side::ask>(1, 1), assert_error);
+            CHECK_THROWS_AS(ptr->insert<side::bid>(Level{}), assert_error);
+            CHECK_THROWS_AS(ptr->insert<side::ask>(Level{}), assert_error);
+            CHECK_THROWS_AS(ptr->emplace<side::bid>(1, 1), assert_error);
+            CHECK_THROWS_AS(ptr->emplace<side::ask>(1, 1), assert_error);
             CHECK_THROWS_AS(ptr->remove<side::bid>(0), assert_error);
             CHECK_THROWS_AS(ptr->remove<side::ask>(0), assert_error);
         }
@@ -638,6 +600,10 @@ TEST_CASE("AnySizeBook_construction", "[book][capacity][construction][bad_capaci
             CHECK_THROWS_AS(ptr->push_back<side::ask>(Level{}), assert_error);
             CHECK_THROWS_AS(ptr->emplace_back<side::bid>(1, 1), assert_error);
             CHECK_THROWS_AS(ptr->emplace_back<side::ask>(1, 1), assert_error);
+            CHECK_THROWS_AS(ptr->insert<side::bid>(Level{}), assert_error);
+            CHECK_THROWS_AS(ptr->insert<side::ask>(Level{}), assert_error);
+            CHECK_THROWS_AS(ptr->emplace<side::bid>(1, 1), assert_error);
+            CHECK_THROWS_AS(ptr->emplace<side::ask>(1, 1), assert_error);
             CHECK_THROWS_AS(ptr->remove<side::bid>(0), assert_error);
             CHECK_THROWS_AS(ptr->remove<side::ask>(0), assert_error);
         }
@@ -648,6 +614,10 @@ TEST_CASE("AnySizeBook_construction", "[book][capacity][construction][bad_capaci
             CHECK_THROWS_AS(ptr->push_back<side::ask>(Level{}), assert_error);
             CHECK_THROWS_AS(ptr->emplace_back<side::bid>(1, 1), assert_error);
             CHECK_THROWS_AS(ptr->emplace_back<side::ask>(1, 1), assert_error);
+            CHECK_THROWS_AS(ptr->insert<side::bid>(Level{}), assert_error);
+            CHECK_THROWS_AS(ptr->insert<side::ask>(Level{}), assert_error);
+            CHECK_THROWS_AS(ptr->emplace<side::bid>(1, 1), assert_error);
+            CHECK_THROWS_AS(ptr->emplace<side::ask>(1, 1), assert_error);
             CHECK_THROWS_AS(ptr->remove<side::bid>(0), assert_error);
             CHECK_THROWS_AS(ptr->remove<side::ask>(0), assert_error);
         }
@@ -990,6 +960,1058 @@ TEST_CASE("AnySizeBook_equal_range", "[book][equal_range]") {
     }
 }
 
+TEST_CASE("AnySizeBook_insert", "[book][insert][emplace][remove]") {
+    using namespace market;
+    constexpr auto npos = AnySizeBook::npos;
+
+    SECTION("insert() and emplace() in empty book") {
+        AnySizeBook book {3};
+        CHECK(book.insert<side::ask>(Level{130130, 1}) == 0);
+        CHECK(book.size<side::ask>() == 1);
+        CHECK(book.emplace<side::bid>(130120, 2) == 0);
+        CHECK(book.size<side::bid>() == 1);
+        CHECK(book.at<side::ask>(0) == Level{130130, 1});
+        CHECK(book.at<side::bid>(0) == Level{130120, 2});
+    }
+
+    SECTION("insert() keeps ask side sorted and returns final position") {
+        AnySizeBook book {5};
+        CHECK(book.insert<side::ask>(Level{130134, 1}) == 0);
+        CHECK(book.insert<side::ask>(Level{130130, 2}) == 0);
+        CHECK(book.insert<side::ask>(Level{130138, 3}) == 2);
+        CHECK(book.insert<side::ask>(Level{130132, 4}) == 1);
+        CHECK(book.insert<side::ask>(Level{130136, 5}) == 3);
+        CHECK(book.insert<side::ask>(Level{130131, 6}) == npos);
+        REQUIRE(book.size<side::ask>() == 5);
+        CHECK(book.at<side::ask>(0) == Level{130130, 2});
+        CHECK(book.at<side::ask>(1) == Level{130132, 4});
+        CHECK(book.at<side::ask>(2) == Level{130134, 1});
+        CHECK(book.at<side::ask>(3) == Level{130136, 5});
+        CHECK(book.at<side::ask>(4) == Level{130138, 3});
+        CHECK(book.size<side::bid>() == 0);
+        CHECK(book.binary_search<side::ask>(130136) == 3);
+    }
+
+    SECTION("emplace() keeps bid side sorted and returns final position") {
+        AnySizeBook book {5};
+        CHECK(book.emplace<side::bid>(130134, 1) == 0);
+        CHECK(book.emplace<side::bid>(130130, 2) == 1);
+        CHECK(book.emplace<side::bid>(130138, 3) == 0);
+        CHECK(book.emplace<side::bid>(130132, 4) == 2);
+        CHECK(book.emplace<side::bid>(130136, 5) == 1);
+        CHECK(book.emplace<side::bid>(130131, 6) == npos);
+        REQUIRE(book.size<side::bid>() == 5);
+        CHECK(book.at<side::bid>(0) == Level{130138, 3});
+        CHECK(book.at<side::bid>(1) == Level{130136, 5});
+        CHECK(book.at<side::bid>(2) == Level{130134, 1});
+        CHECK(book.at<side::bid>(3) == Level{130132, 4});
+        CHECK(book.at<side::bid>(4) == Level{130130, 2});
+        CHECK(book.size<side::ask>() == 0);
+    }
+
+    SECTION("insert() places level after levels which compare equal") {
+        AnySizeBook book {4};
+        CHECK(book.emplace<side::ask>(130130, 1) == 0);
+        CHECK(book.emplace<side::ask>(130132, 1) == 1);
+        CHECK(book.emplace<side::ask>(130130, 2) == 1);
+        CHECK(book.emplace<side::ask>(130130, 3) == 2);
+        CHECK(book.at<side::ask>(0) == Level{130130, 1});
+        CHECK(book.at<side::ask>(1) == Level{130130, 2});
+        CHECK(book.at<side::ask>(2) == Level{130130, 3});
+        CHECK(book.at<side::ask>(3) == Level{130132, 1});
+    }
+
+    SECTION("insert() does not move elements, only their indices, and reuses free space") {
+        AnySizeBook book {3};
+        CHECK(book.emplace<side::bid>(130130, 1) == 0);
+        CHECK(book.emplace<side::bid>(130134, 1) == 0);
+        const auto* p0 = &book.at<side::bid>(0);
+        const auto* p1 = &book.at<side::bid>(1);
+        CHECK(book.emplace<side::bid>(130132, 1) == 1);
+        CHECK(p0 == &book.at<side::bid>(0));
+        CHECK(p1 == &book.at<side::bid>(2));
+        CHECK(book.full<side::bid>());
+
+        book.remove<side::bid>(1);
+        CHECK(book.insert<side::bid>(Level{130136, 2}) == 0);
+        CHECK(book.insert<side::bid>(Level{130138, 2}) == npos);
+        CHECK(book.at<side::bid>(0) == Level{130136, 2});
+        CHECK(p0 == &book.at<side::bid>(1));
+        CHECK(p1 == &book.at<side::bid>(2));
+
+        // Other side can use remaining free space
+        CHECK(book.insert<side::ask>(Level{130140, 2}) == 0);
+        CHECK(book.insert<side::ask>(Level{130139, 2}) == 0);
+        CHECK(book.insert<side::ask>(Level{130141, 2}) == 2);
+        CHECK(book.insert<side::ask>(Level{130142, 2}) == npos);
+    }
+
+    SECTION("insert() after push_back() and sort() gives the same result") {
+        AnySizeBook book1 {20};
+        AnySizeBook book2 {20};
+        const int prices[] = {7, 3, 9, 1, 3, 15, 0, 11, 8, 3};
+        for (int i : prices) {
+            book1.push_back<side::bid>(Level{i, 1});
+            book1.sort<side::bid>();
+            book2.insert<side::bid>(Level{i, 1});
+        }
+        REQUIRE(book1.size<side::bid>() == book2.size<side::bid>());
+        for (uint8_t i = 0; i < book1.size<side::bid>(); ++i) {
+            CHECK(book1.at<side::bid>(i) == book2.at<side::bid>(i));
+        }
+    }
+}
+
+namespace {
+    struct LinearBook : market::book<Level, LinearPolicy> {
+        LinearBook() : book(data, 0, 0) {
+            reset();
+        }
+
+        using book::reset;
+
+        book::data<40> data;
+    };
+
+    struct LinearAnySizeBook : market::book<Level, LinearPolicy> {
+        Level levels[254] = {};
+        uint8_t sides[254] = {};
+        uint8_t freel[254] = {};
+        int32_t keys[254] = {};
+
+        explicit LinearAnySizeBook(int i) : book(levels, sides, freel, i, 0, 0) {
+            book::keys = keys;
+            accept();
+        }
+
+        template <market::side Side, size_t Size>
+        void populate(Level const (&input)[Size], size_type offset) {
+            size_type i = 0;
+            for (auto const &l : input) {
+                sides[(size_t)Side * capacity + i] = offset + i;
+                levels[offset + i++] = l; // Note: must post-increment
+            }
+            side_i[(size_t)Side] = i;
+        }
+
+        using book::accept;
+    };
+
+    template <market::side Side, typename Lh, typename Rh>
+    void check_same_search(const Lh& lh, const Rh& rh, int from, int to) {
+        REQUIRE(lh.template size<Side>() == rh.template size<Side>());
+        for (uint8_t i = 0; i < lh.template size<Side>(); ++i) {
+            CHECK(lh.template at<Side>(i) == rh.template at<Side>(i));
+        }
+        for (int p = from; p <= to; ++p) {
+            CHECK(lh.template lower_bound<Side>(p) == rh.template lower_bound<Side>(p));
+            CHECK(lh.template upper_bound<Side>(p) == rh.template upper_bound<Side>(p));
+            CHECK(lh.template equal_range<Side>(p) == rh.template equal_range<Side>(p));
+            // With duplicate prices, binary_search() may find any of the matching levels
+            const auto i = lh.template binary_search<Side>(p);
+            const auto j = rh.template binary_search<Side>(p);
+            CHECK((i == AnySizeBook::npos) == (j == AnySizeBook::npos));
+            if (i != AnySizeBook::npos) {
+                CHECK(lh.template at<Side>(i).ticks == p);
+            }
+        }
+    }
+}
+
+TEST_CASE("LinearBook_search", "[book][linear][binary_search][lower_bound][upper_bound][equal_range][insert][remove]") {
+    using namespace market;
+    constexpr auto npos = LinearBook::npos;
+    static_assert(LinearBook::linear);
+    static_assert(not AnySizeBook::linear);
+    // Keys are not stored at all in binary search mode
+    static_assert(sizeof(market::book<Level, LinearPolicy>) > sizeof(market::book<Level>));
+
+    SECTION("empty book") {
+        LinearBook book;
+        CHECK(book.binary_search<side::bid>(130130) == npos);
+        CHECK(book.lower_bound<side::ask>(130130) == npos);
+        CHECK(book.upper_bound<side::ask>(130130) == npos);
+        CHECK(book.equal_range<side::bid>(130130) == make(npos, npos));
+    }
+
+    SECTION("same results as binary search, for all sizes") {
+        // Prices with duplicates, so equal_range() is also tested on longer ranges
+        const int prices[] = {130, 104, 117, 125, 104, 111, 139, 101, 120, 117, 133, 108, 136, 102, 117,
+                              129, 115, 131, 122, 104, 113, 127, 100, 138, 117, 106, 110, 124, 134, 119,
+                              103, 137, 121, 118, 126, 109, 112, 135, 105, 128};
+        for (int size = 1; size <= 40; ++size) {
+            LinearBook book1;
+            AnySizeBook book2 {40};
+            for (int i = 0; i < size; ++i) {
+                book1.push_back<side::bid>(Level{prices[i], i});
+                book2.push_back<side::bid>(Level{prices[i], i});
+                book1.push_back<side::ask>(Level{prices[i], i});
+                book2.push_back<side::ask>(Level{prices[i], i});
+            }
+            book1.sort<side::bid>();
+            book2.sort<side::bid>();
+            book1.sort<side::ask>();
+            book2.sort<side::ask>();
+            for (int p = 98; p <= 141; ++p) {
+                CHECK(book1.lower_bound<side::bid>(p) == book2.lower_bound<side::bid>(p));
+                CHECK(book1.upper_bound<side::bid>(p) == book2.upper_bound<side::bid>(p));
+                CHECK(book1.equal_range<side::bid>(p) == book2.equal_range<side::bid>(p));
+                CHECK(book1.lower_bound<side::ask>(p) == book2.lower_bound<side::ask>(p));
+                CHECK(book1.upper_bound<side::ask>(p) == book2.upper_bound<side::ask>(p));
+                CHECK(book1.equal_range<side::ask>(p) == book2.equal_range<side::ask>(p));
+                const auto found = book2.binary_search<side::bid>(p) == npos ? npos : book2.lower_bound<side::bid>(p);
+                CHECK(book1.find<side::bid>(Level{p, 0}) == found);
+                CHECK(book2.find<side::bid>(Level{p, 0}) == found);
+                CHECK(book1.find<side::ask>(Level{p, 0}) == book2.find<side::ask>(Level{p, 0}));
+                CHECK((book1.binary_search<side::bid>(p) == npos) == (book2.binary_search<side::bid>(p) == npos));
+                CHECK((book1.binary_search<side::ask>(p) == npos) == (book2.binary_search<side::ask>(p) == npos));
+            }
+        }
+    }
+
+    SECTION("insert(), emplace() and remove() maintain keys") {
+        LinearBook book1;
+        AnySizeBook book2 {40};
+        const int prices[] = {130, 104, 117, 125, 104, 111, 139, 101, 120, 117, 133, 108, 136, 102, 117};
+        for (int i : prices) {
+            CHECK(book1.insert<side::bid>(Level{i, i}) == book2.insert<side::bid>(Level{i, i}));
+            CHECK(book1.emplace<side::ask>(i, i) == book2.emplace<side::ask>(i, i));
+        }
+        check_same_search<side::bid>(book1, book2, 98, 141);
+        check_same_search<side::ask>(book1, book2, 98, 141);
+
+        for (uint8_t i : {0, 13, 5, 5, 0, 9}) {
+            book1.remove<side::bid>(i);
+            book2.remove<side::bid>(i);
+            book1.remove<side::ask>(i);
+            book2.remove<side::ask>(i);
+            check_same_search<side::bid>(book1, book2, 98, 141);
+            check_same_search<side::ask>(book1, book2, 98, 141);
+        }
+
+        // push_back() followed by sort() is also fine
+        CHECK(book1.push_back<side::bid>(Level{131, 1}) == book2.push_back<side::bid>(Level{131, 1}));
+        book1.sort<side::bid>();
+        book2.sort<side::bid>();
+        check_same_search<side::bid>(book1, book2, 98, 141);
+
+        SECTION("sort() refreshes keys after price change") {
+            book1.at<side::ask>(0).ticks = 140;
+            book2.at<side::ask>(0).ticks = 140;
+            book1.sort<side::ask>();
+            book2.sort<side::ask>();
+            check_same_search<side::ask>(book1, book2, 98, 141);
+        }
+    }
+
+    SECTION("accept() populates keys") {
+        Level bids[3] = {Level{130140, 10}, Level{130130, 100}, Level{130120, 1}};
+        Level offers[2] = {Level{130170, 20}, Level{130180, 40}};
+        LinearAnySizeBook book {10};
+        book.populate<side::bid>(bids, 0);
+        book.populate<side::ask>(offers, 3);
+        book.accept();
+        CHECK(book.binary_search<side::bid>(130130) == 1);
+        CHECK(book.binary_search<side::bid>(130120) == 2);
+        CHECK(book.lower_bound<side::bid>(130135) == 1);
+        CHECK(book.binary_search<side::ask>(130180) == 1);
+        CHECK(book.upper_bound<side::ask>(130170) == 1);
+        CHECK(book.emplace<side::ask>(130175, 1) == 1);
+        CHECK(book.binary_search<side::ask>(130180) == 2);
+        CHECK(book.size<side::ask>() == 3);
+    }
+}
+
+namespace {
+    struct DeepBook : market::book<Level, Level, uint16_t> {
+        DeepBook() : book(data, 0, 0) {
+            reset();
+        }
+
+        book::data<1000> data;
+    };
+
+    struct DeepLinearBook : market::book<Level, LinearPolicy, uint16_t> {
+        DeepLinearBook() : book(data, 0, 0) {
+            reset();
+        }
+
+        book::data<1000> data;
+    };
+
+    struct DeepAnySizeBook : market::book<Level, Level, uint16_t> {
+        std::unique_ptr<Level[]> levels;
+        std::unique_ptr<uint16_t[]> sides;
+        std::unique_ptr<uint16_t[]> freel;
+
+        explicit DeepAnySizeBook(int i)
+                : book(nullptr, nullptr, nullptr, i, 0, 0)
+                , levels(new Level[2 * i])
+                , sides(new uint16_t[2 * i])
+                , freel(new uint16_t[2 * i]) {
+            book::levels = levels.get();
+            book::sides = sides.get();
+            book::freel = freel.get();
+            reset();
+        }
+    };
+}
+
+namespace {
+    struct BatchOp {
+        market::action what;
+        Level level;
+    };
+
+    // Apply operations one by one, in the order documented for apply_batch()
+    template <market::side Side, typename Book>
+    std::size_t apply_each(Book& book, std::vector<BatchOp> ops) {
+        std::stable_sort(ops.begin(), ops.end(), [](const BatchOp& lh, const BatchOp& rh) {
+            if (Level::compare<Side>(lh.level, rh.level)) {
+                return true;
+            } else if (Level::compare<Side>(rh.level, lh.level)) {
+                return false;
+            }
+            return (int)lh.what > (int)rh.what;
+        });
+        std::size_t applied = 0;
+        for (const auto& o : ops) {
+            if (o.what == market::action::insert) {
+                continue;
+            }
+            const auto i = book.template find<Side>(o.level);
+            if (i == Book::npos) {
+                continue;
+            } else if (o.what == market::action::update) {
+                book.template at<Side>(i) = o.level;
+            } else {
+                book.template remove<Side>(i);
+            }
+            ++applied;
+        }
+        for (const auto& o : ops) {
+            if (o.what == market::action::insert && book.template insert<Side>(o.level) != Book::npos) {
+                ++applied;
+            }
+        }
+        return applied;
+    }
+
+    template <market::side Side, typename Book>
+    void check_apply_batch(Book& book1, Book& book2, int seed) {
+        std::mt19937 gen(seed);
+        std::uniform_int_distribution<int> price(100, 140);
+        std::uniform_int_distribution<int> action(0, 2);
+        std::uniform_int_distribution<int> count(0, 30);
+        for (int n = 0; n < 200; ++n) {
+            std::vector<BatchOp> ops(count(gen));
+            for (auto& o : ops) {
+                o = BatchOp{(market::action)action(gen), Level{price(gen), n}};
+            }
+            auto copy = ops;
+            const auto applied = book1.template apply_batch<Side>(std::span<BatchOp>(copy));
+            CHECK(applied == apply_each<Side>(book2, ops));
+            REQUIRE(book1.template size<Side>() == book2.template size<Side>());
+            for (int i = 0; i < (int)book1.template size<Side>(); ++i) {
+                CHECK(book1.template at<Side>(i) == book2.template at<Side>(i));
+            }
+            check_same_search<Side>(book1, book2, 99, 141);
+        }
+    }
+}
+
+TEST_CASE("Book_apply_batch", "[book][apply_batch][insert][remove][linear]") {
+    using namespace market;
+    using action = market::action;
+
+    SECTION("simple batch") {
+        AnySizeBook book{5};
+        book.insert<side::bid>(Level{100, 1});
+        book.insert<side::bid>(Level{98, 2});
+        book.insert<side::bid>(Level{96, 3});
+        BatchOp ops[] = {
+            {action::insert, Level{97, 4}},
+            {action::erase, Level{100, 0}},
+            {action::update, Level{96, 5}},
+            {action::insert, Level{101, 6}},
+            {action::erase, Level{99, 0}}, // Missing
+            {action::insert, Level{98, 7}}, // After existing level with the same price
+        };
+        CHECK(book.apply_batch<side::bid>(std::span<BatchOp>(ops)) == 5);
+        REQUIRE(book.size<side::bid>() == 5);
+        CHECK(book.at<side::bid>(0) == Level{101, 6});
+        CHECK(book.at<side::bid>(1) == Level{98, 2});
+        CHECK(book.at<side::bid>(2) == Level{98, 7});
+        CHECK(book.at<side::bid>(3) == Level{97, 4});
+        CHECK(book.at<side::bid>(4) == Level{96, 5});
+        CHECK(*book.top<side::bid>() == Level{101, 6});
+        CHECK(book.empty<side::ask>());
+
+        // Side is full, deepest inserts are skipped but erase makes room
+        BatchOp more[] = {
+            {action::insert, Level{90, 8}},
+            {action::insert, Level{102, 9}},
+            {action::erase, Level{96, 0}},
+            {action::insert, Level{91, 10}},
+        };
+        CHECK(book.apply_batch<side::bid>(std::span<BatchOp>(more)) == 2);
+        REQUIRE(book.size<side::bid>() == 5);
+        CHECK(book.at<side::bid>(0) == Level{102, 9});
+        CHECK(book.at<side::bid>(4) == Level{97, 4});
+        CHECK(book.insert<side::ask>(Level{103, 1}) == 0);
+        CHECK(book.full<side::bid>());
+        CHECK(not book.full<side::ask>());
+    }
+
+    SECTION("same as one by one") {
+        AnySizeBook book1{20}, book2{20};
+        check_apply_batch<side::bid>(book1, book2, 1);
+        check_apply_batch<side::ask>(book1, book2, 2);
+    }
+
+    SECTION("same as one by one, linear search") {
+        LinearBook book1, book2;
+        check_apply_batch<side::bid>(book1, book2, 3);
+        check_apply_batch<side::ask>(book1, book2, 4);
+    }
+}
+
+namespace {
+    // Change prices of "changes" random levels on Side of both books, then sort book1 with sort() or
+    // resort_one() (if a single level changed) and compare with book2 sorted with std::stable_sort
+    template <market::side Side, typename Book1, typename Book2>
+    void check_resort(Book1& book1, Book2& book2, int seed, int changes) {
+        std::mt19937 gen(seed);
+        std::uniform_int_distribution<int> price(100, 140);
+        const auto less = [](const Level& lh, const Level& rh) { return Level::compare<Side>(lh, rh); };
+        for (int n = 0; n < 200; ++n) {
+            book1.reset();
+            std::vector<Level> levels;
+            const int size = std::uniform_int_distribution<int>(1, 30)(gen);
+            for (int i = 0; i < size; ++i) {
+                levels.push_back(Level{price(gen), i});
+                book1.template insert<Side>(levels.back());
+            }
+            std::stable_sort(levels.begin(), levels.end(), less);
+            std::uniform_int_distribution<int> pos(0, size - 1);
+            int last = 0;
+            for (int c = 0; c < changes; ++c) {
+                last = pos(gen);
+                levels[last].ticks = book1.template at<Side>(last).ticks = price(gen);
+            }
+
+            if (changes == 1) {
+                // Moved level is placed after levels which compare equal
+                const auto l = levels[last];
+                levels.erase(levels.begin() + last);
+                const auto i = std::upper_bound(levels.begin(), levels.end(), l, less);
+                const auto j = (int)(i - levels.begin());
+                levels.insert(i, l);
+                CHECK(book1.template resort_one<Side>(last) == j);
+                CHECK(book1.template top<Side>()->size == levels[0].size);
+            } else {
+                book1.template sort<Side>();
+                std::stable_sort(levels.begin(), levels.end(), less);
+            }
+            book2.reset();
+            REQUIRE(book1.template size<Side>() == size);
+            for (int i = 0; i < size; ++i) {
+                CHECK(book1.template at<Side>(i).ticks == levels[i].ticks);
+                book2.template push_back<Side>(book1.template at<Side>(i));
+            }
+            if (changes == 1) {
+                for (int i = 0; i < size; ++i) {
+                    CHECK(book1.template at<Side>(i) == levels[i]);
+                }
+            }
+            check_same_search<Side>(book1, book2, 99, 141);
+        }
+    }
+}
+
+TEST_CASE("Book_resort", "[book][sort][resort_one][linear]") {
+    using namespace market;
+
+    SECTION("resort_one() moves single level") {
+        AnySizeBook book{5};
+        for (int i : {104, 103, 102, 101, 100}) {
+            book.push_back<side::bid>(Level{i, i});
+        }
+        book.at<side::bid>(1).ticks = 100;
+        CHECK(book.resort_one<side::bid>(1) == 4);
+        CHECK(book.at<side::bid>(3) == Level{100, 100});
+        CHECK(book.at<side::bid>(4) == Level{100, 103});
+        book.at<side::bid>(4).ticks = 105;
+        const auto generation = book.generation();
+        CHECK(book.resort_one<side::bid>(4) == 0);
+        CHECK(*book.top<side::bid>() == Level{105, 103});
+        CHECK(book.generation() != generation);
+        book.at<side::bid>(2).ticks = 102;
+        CHECK(book.resort_one<side::bid>(2) == 2);
+        CHECK(book.at<side::bid>(2) == Level{102, 102});
+    }
+
+    SECTION("sort() and resort_one() same as std::stable_sort") {
+        for (int changes : {1, 2, 3, 8, 30}) {
+            AnySizeBook book1{30}, book2{30};
+            check_resort<side::bid>(book1, book2, changes, changes);
+            check_resort<side::ask>(book1, book2, changes + 100, changes);
+        }
+    }
+
+    SECTION("sort() and resort_one() refresh keys") {
+        for (int changes : {1, 2, 30}) {
+            LinearBook book1;
+            AnySizeBook book2{30};
+            check_resort<side::bid>(book1, book2, changes, changes);
+            check_resort<side::ask>(book1, book2, changes + 100, changes);
+        }
+    }
+}
+
+TEST_CASE("Book_iterators", "[book][begin][end][range][at]") {
+    using namespace market;
+    AnySizeBook book{5};
+    CHECK(book.begin<side::bid>() == book.end<side::bid>());
+    CHECK(std::ranges::empty(book.range<side::ask>()));
+    for (int i : {104, 103, 101, 100}) {
+        book.push_back<side::bid>(Level{i, i - 100});
+    }
+    book.insert<side::bid>(Level{102, 2});
+    book.push_back<side::ask>(Level{105, 10});
+
+    auto b = book.begin<side::bid>();
+    const auto e = book.end<side::bid>();
+    REQUIRE(e - b == 5);
+    for (int i = 0; i < 5; ++i) {
+        CHECK(&b[i] == &book.at<side::bid>(i));
+        CHECK(&*(b + i) == &book.at<side::bid>(i));
+    }
+    CHECK(b->ticks == 104);
+    CHECK((e - 1)->ticks == 100);
+    CHECK(b < e);
+    CHECK(++b == book.begin<side::bid>() + 1);
+    CHECK(b-- != book.begin<side::bid>());
+    CHECK(b == book.begin<side::bid>());
+
+    SECTION("standard algorithms") {
+        const auto sum = std::accumulate(book.begin<side::bid>(), book.end<side::bid>(), 0,
+                [](int t, const Level& l) { return t + l.size; });
+        CHECK(sum == 10);
+        const auto it = std::find_if(book.begin<side::bid>(), book.end<side::bid>(),
+                [](const Level& l) { return l.ticks < 103; });
+        CHECK(it - book.begin<side::bid>() == 2);
+        CHECK(std::is_sorted(book.begin<side::bid>(), book.end<side::bid>(), [](const Level& lh, const Level& rh) {
+            return Level::compare<side::bid>(lh, rh);
+        }));
+        std::vector<int> partial(5);
+        std::transform_inclusive_scan(book.cbegin<side::bid>(), book.cend<side::bid>(), partial.begin(),
+                std::plus<>{}, [](const Level& l) { return l.size; });
+        CHECK(partial == std::vector<int>{4, 7, 9, 10, 10});
+    }
+
+    SECTION("ranges") {
+        auto r = book.range<side::bid>();
+        static_assert(std::ranges::random_access_range<decltype(r)>);
+        static_assert(std::ranges::view<decltype(r)>);
+        CHECK(std::ranges::size(r) == 5);
+        std::vector<int> ticks;
+        for (const auto& l : r | std::views::take(3)) {
+            ticks.push_back(l.ticks);
+        }
+        CHECK(ticks == std::vector<int>{104, 103, 102});
+        CHECK(std::ranges::find(r, 101, &Level::ticks) - r.begin() == 3);
+        CHECK(std::ranges::distance(book.range<side::ask>()) == 1);
+    }
+
+    SECTION("mutable and const iterators") {
+        for (auto& l : book.range<side::bid>()) {
+            l.size *= 10;
+        }
+        CHECK(book.at<side::bid>(0) == Level{104, 40});
+        const AnySizeBook& cbook = book;
+        AnySizeBook::const_iterator c = book.begin<side::bid>();
+        CHECK(c == cbook.begin<side::bid>());
+        static_assert(std::is_same_v<decltype(*c), const Level&>);
+        static_assert(std::is_same_v<decltype(cbook.range<side::bid>().begin()), AnySizeBook::const_iterator>);
+        CHECK(std::ranges::max(cbook.range<side::bid>(), {}, &Level::size) == Level{104, 40});
+    }
+}
+
+namespace {
+    // Structure of arrays storage of Level, with separate arrays of ticks and sizes
+    struct ColumnsPolicy {
+        struct const_reference {
+            const int* ticks; const int* size;
+
+            operator Level() const { return Level{*ticks, *size}; }
+        };
+
+        struct reference {
+            int* ticks; int* size;
+
+            reference& operator=(const Level& l) {
+                *ticks = l.ticks;
+                *size = l.size;
+                return *this;
+            }
+
+            // Assignment copies the level, same as for Level&
+            reference& operator=(const reference& o) {
+                return *this = (Level)o;
+            }
+
+            operator Level() const { return Level{*ticks, *size}; }
+            operator const_reference() const { return {ticks, size}; }
+        };
+
+        struct storage {
+            int* ticks = nullptr; int* size = nullptr;
+
+            using reference = ColumnsPolicy::reference;
+            using const_reference = ColumnsPolicy::const_reference;
+
+            reference operator[](std::size_t i) const {
+                return {ticks + i, size + i};
+            }
+        };
+
+        // Function compare only reads ticks
+        static int ticks_(int i) { return i; }
+        static int ticks_(const Level& l) { return l.ticks; }
+        static int ticks_(const reference& r) { return *r.ticks; }
+        static int ticks_(const const_reference& r) { return *r.ticks; }
+
+        template <market::side Side, typename Lh, typename Rh>
+        static bool compare(const Lh& lh, const Rh& rh) noexcept {
+            return Side == market::side::bid ? ticks_(lh) > ticks_(rh) : ticks_(lh) < ticks_(rh);
+        }
+
+        static int make(int i) {
+            return i;
+        }
+    };
+
+    struct ColumnsBook : market::book<Level, ColumnsPolicy> {
+        int prices[60] = {};
+        int sizes[60] = {};
+        uint8_t sides[60] = {};
+        uint8_t freel[60] = {};
+
+        ColumnsBook() : book(storage_type{prices, sizes}, sides, freel, 30, 0, 0) {
+            reset();
+        }
+
+        using book::reset;
+    };
+}
+
+TEST_CASE("ColumnsBook_storage", "[book][columns][insert][emplace][remove][sort][binary_search][find][at][begin][end]") {
+    using namespace market;
+    static_assert(ColumnsBook::columns && not AnySizeBook::columns);
+    static_assert(std::is_same_v<decltype(std::declval<ColumnsBook&>().at<side::bid>(0)), ColumnsPolicy::reference>);
+    static_assert(std::random_access_iterator<ColumnsBook::const_iterator>);
+
+    SECTION("fields are stored in separate arrays") {
+        ColumnsBook book;
+        CHECK(book.insert<side::bid>(Level{100, 1}) == 0);
+        CHECK(book.insert<side::bid>(Level{102, 2}) == 0);
+        CHECK(book.emplace<side::bid>(Level{101, 3}) == 1);
+        CHECK(book.push_back<side::ask>(Level{104, 4}) == 0);
+        REQUIRE(book.size<side::bid>() == 3);
+        CHECK((Level)book.at<side::bid>(0) == Level{102, 2});
+        CHECK((Level)book.at<side::bid>(1) == Level{101, 3});
+        const auto l = book.at<side::bid>(1);
+        CHECK(l.ticks - book.prices == l.size - book.sizes);
+        CHECK(book.prices[l.ticks - book.prices] == 101);
+        CHECK(book.binary_search<side::bid>(100) == 2);
+        CHECK(book.find<side::bid>(Level{101, 0}) == 1);
+        CHECK(book.lower_bound<side::ask>(103) == 0);
+
+        book.at<side::bid>(2) = Level{103, 5};
+        book.sort<side::bid>();
+        CHECK((Level)book.at<side::bid>(0) == Level{103, 5});
+        book.remove<side::bid>(0);
+        CHECK((Level)book.at<side::bid>(0) == Level{102, 2});
+
+        const ColumnsBook& cbook = book;
+        int total = 0;
+        for (ColumnsPolicy::const_reference l : cbook.range<side::bid>()) {
+            total += *l.size;
+        }
+        CHECK(total == 5);
+        CHECK(std::accumulate(book.begin<side::bid>(), book.end<side::bid>(), 0,
+                [](int t, const Level& l) { return t + l.size; }) == 5);
+    }
+
+    SECTION("same as array of levels") {
+        ColumnsBook book1;
+        AnySizeBook book2{30};
+        std::mt19937 gen(3);
+        std::uniform_int_distribution<int> price(100, 140);
+        for (int n = 0; n < 2000; ++n) {
+            const int p = price(gen);
+            if (gen() % 3 == 0 && book2.size<side::bid>() > 0) {
+                const auto i = (uint8_t)(gen() % book2.size<side::bid>());
+                book1.remove<side::bid>(i);
+                book2.remove<side::bid>(i);
+            } else {
+                REQUIRE(book1.insert<side::bid>(Level{p, n}) == book2.insert<side::bid>(Level{p, n}));
+            }
+            REQUIRE(book1.binary_search<side::bid>(p) == book2.binary_search<side::bid>(p));
+            REQUIRE(book1.upper_bound<side::bid>(p) == book2.upper_bound<side::bid>(p));
+            REQUIRE(book1.size<side::bid>() == book2.size<side::bid>());
+            for (int i = 0; i < (int)book2.size<side::bid>(); ++i) {
+                REQUIRE((Level)book1.at<side::bid>(i) == book2.at<side::bid>(i));
+            }
+        }
+    }
+}
+
+namespace {
+    struct CumulativeBook : market::book<Level, CumulativePolicy> {
+        CumulativeBook() : book(data, 0, 0) {
+            reset();
+        }
+
+        using book::reset;
+
+        book::data<30> data;
+    };
+
+    struct CumulativeLinearPolicy : LinearPolicy {
+        constexpr static bool cumulative = true;
+
+        constexpr static int quantity(const Level& l) noexcept {
+            return l.size;
+        }
+
+        constexpr static int tick(const Level& l) noexcept {
+            return l.ticks;
+        }
+    };
+
+    struct CumulativeLinearBook : market::book<Level, CumulativeLinearPolicy> {
+        CumulativeLinearBook() : book(data, 0, 0) {
+            reset();
+        }
+
+        using book::reset;
+
+        book::data<30> data;
+    };
+
+    // Totals and sweep computed from scratch, for comparison
+    template <market::side Side, typename Book>
+    void check_totals(const Book& book) {
+        const auto size = book.template size<Side>();
+        std::int64_t quantity = 0, notional = 0;
+        for (int i = 0; i < (int)size; ++i) {
+            const auto& l = book.template at<Side>(i);
+            quantity += l.size;
+            notional += (std::int64_t)l.size * l.ticks;
+            const auto d = book.template depth<Side>(i + 1);
+            REQUIRE(d.quantity == quantity);
+            REQUIRE(d.notional == notional);
+        }
+        for (std::int64_t q : {1l, 5l, 17l, quantity / 2, quantity, quantity + 1}) {
+            std::int64_t left = q, filled = 0, value = 0;
+            int last = -1;
+            for (int i = 0; i < (int)size && left > 0; ++i) {
+                const auto& l = book.template at<Side>(i);
+                const auto take = std::min<std::int64_t>(left, l.size);
+                left -= take;
+                filled += take;
+                value += take * l.ticks;
+                last = i;
+            }
+            const auto f = book.template sweep<Side>(q);
+            if (q <= 0 || last == -1) {
+                REQUIRE(f.last == Book::npos);
+                continue;
+            }
+            REQUIRE(f.last == last);
+            REQUIRE(f.quantity == filled);
+            REQUIRE(f.notional == value);
+        }
+    }
+}
+
+TEST_CASE("CumulativeBook_sweep", "[book][cumulative][depth][within][sweep][recount][insert][remove][sort]") {
+    using namespace market;
+    static_assert(CumulativeBook::cumulative && not AnySizeBook::cumulative);
+
+    SECTION("basic queries") {
+        CumulativeBook book;
+        CHECK(book.sweep<side::ask>(10).last == CumulativeBook::npos);
+        CHECK(book.within<side::ask>(10).quantity == 0);
+        book.insert<side::ask>(Level{102, 5});
+        book.insert<side::ask>(Level{100, 10});
+        book.insert<side::ask>(Level{101, 20});
+        book.push_back<side::ask>(Level{105, 1});
+        CHECK(book.depth<side::ask>(0).quantity == 0);
+        CHECK(book.depth<side::ask>(2).quantity == 30);
+        CHECK(book.depth<side::ask>(2).notional == 1000 + 2020);
+        CHECK(book.within<side::ask>(0).quantity == 10);
+        CHECK(book.within<side::ask>(2).quantity == 35);
+        CHECK(book.within<side::ask>(100).quantity == 36);
+
+        auto f = book.sweep<side::ask>(25);
+        CHECK(f.last == 1);
+        CHECK(f.quantity == 25);
+        CHECK(f.notional == 1000 + 15 * 101);
+        CHECK(f.vwap() == Approx(2515.0 / 25));
+        f = book.sweep<side::ask>(100);
+        CHECK(f.last == 3);
+        CHECK(f.quantity == 36);
+        CHECK(book.sweep<side::ask>(10).last == 0);
+        CHECK(book.sweep<side::ask>(11).last == 1);
+
+        book.at<side::ask>(0).size = 1;
+        book.recount<side::ask>(0);
+        CHECK(book.depth<side::ask>(4).quantity == 27);
+        book.remove<side::ask>(1);
+        CHECK(book.sweep<side::ask>(3).notional == 100 + 2 * 102);
+        book.at<side::ask>(2).ticks = 99;
+        book.resort_one<side::ask>(2);
+        CHECK(book.sweep<side::ask>(1).notional == 99);
+        check_totals<side::ask>(book);
+    }
+
+    SECTION("random operations") {
+        CumulativeBook book1;
+        CumulativeLinearBook book2;
+        std::mt19937 gen(5);
+        std::uniform_int_distribution<int> price(100, 140);
+        std::uniform_int_distribution<int> size(1, 50);
+        for (int n = 0; n < 3000; ++n) {
+            const auto c = gen() % 6;
+            const Level l{price(gen), size(gen)};
+            if (c < 2 && book1.size<side::bid>() > 0) {
+                const auto i = (uint8_t)(gen() % book1.size<side::bid>());
+                book1.remove<side::bid>(i);
+                book2.remove<side::bid>(i);
+            } else if (c == 2 && book1.size<side::bid>() > 0) {
+                const auto i = (uint8_t)(gen() % book1.size<side::bid>());
+                book1.at<side::bid>(i).size = l.size;
+                book1.recount<side::bid>(i);
+                book2.at<side::bid>(i).size = l.size;
+                book2.recount<side::bid>(i);
+            } else if (c == 3 && not book1.full<side::bid>()) {
+                book1.push_back<side::bid>(l);
+                book1.sort<side::bid>();
+                book2.push_back<side::bid>(l);
+                book2.sort<side::bid>();
+            } else {
+                book1.insert<side::bid>(l);
+                book2.insert<side::bid>(l);
+            }
+            check_totals<side::bid>(book1);
+            check_totals<side::bid>(book2);
+            const auto d = (std::int64_t)(gen() % 10);
+            REQUIRE(book1.within<side::bid>(d).quantity == book2.within<side::bid>(d).quantity);
+        }
+    }
+}
+
+TEST_CASE("DeepBook_index_width", "[book][capacity][bad_capacity][insert][remove][binary_search][lower_bound]") {
+    using namespace market;
+    static_assert(DeepBook::npos == 65535);
+    static_assert(DeepBook::max_capacity == 32767);
+    static_assert(AnySizeBook::npos == 255);
+    static_assert(AnySizeBook::max_capacity == 127);
+    // Footprint of default book unchanged, i.e. one byte for each element of sides and freel
+    static_assert(sizeof(SmallBook::data) == sizeof(Level) * 6 + 6 + 6);
+    static_assert(sizeof(DeepBook::data) == sizeof(Level) * 2000 + 4000 + 4000);
+
+    SECTION("capacity above 127 levels") {
+        std::unique_ptr<DeepAnySizeBook> ptr = nullptr;
+        CHECK_NOTHROW(ptr.reset(new DeepAnySizeBook(128)));
+        CHECK(ptr->capacity == 128);
+        CHECK_NOTHROW(ptr.reset(new DeepAnySizeBook(32767)));
+        CHECK(ptr->capacity == 32767);
+        CHECK_THROWS_AS(ptr.reset(new DeepAnySizeBook(32768)), DeepAnySizeBook::bad_capacity);
+        CHECK_THROWS_AS(ptr.reset(new DeepAnySizeBook(-1)), DeepAnySizeBook::bad_capacity);
+    }
+
+    SECTION("fill both sides to capacity") {
+        auto book = std::make_unique<DeepBook>();
+        REQUIRE(book->capacity == 1000);
+        // Insert in pseudo-random order, 7 is co-prime with 1000
+        for (int i = 0; i < 1000; ++i) {
+            const int p = (i * 7) % 1000;
+            CHECK(book->insert<side::bid>(Level{100000 - 2 * p, i}) != DeepBook::npos);
+            CHECK(book->emplace_back<side::ask>(100002 + 2 * p, i) == i);
+        }
+        CHECK(book->full<side::bid>());
+        CHECK(book->full<side::ask>());
+        CHECK(book->insert<side::bid>(Level{1, 1}) == DeepBook::npos);
+        CHECK(book->emplace_back<side::ask>(1, 1) == DeepBook::npos);
+        book->sort<side::ask>();
+
+        for (uint16_t i = 0; i < 1000; ++i) {
+            CHECK(book->at<side::bid>(i).ticks == 100000 - 2 * i);
+            CHECK(book->at<side::ask>(i).ticks == 100002 + 2 * i);
+        }
+        CHECK(book->binary_search<side::bid>(100000 - 2 * 700) == 700);
+        CHECK(book->binary_search<side::bid>(100000 - 2 * 700 + 1) == DeepBook::npos);
+        CHECK(book->lower_bound<side::ask>(100002 + 2 * 999 - 1) == 999);
+        CHECK(book->upper_bound<side::ask>(100002 + 2 * 999) == DeepBook::npos);
+        CHECK(book->equal_range<side::ask>(100002 + 2 * 300) == std::make_pair<uint16_t, uint16_t>(300, 301));
+
+        book->remove<side::bid>(300);
+        CHECK(book->size<side::bid>() == 999);
+        CHECK(book->at<side::bid>(300).ticks == 100000 - 2 * 301);
+        CHECK(book->emplace<side::ask>(100001, 1) == DeepBook::npos);
+        CHECK(book->emplace<side::bid>(100001, 1) == 0);
+    }
+
+    SECTION("linear search mode") {
+        auto book1 = std::make_unique<DeepLinearBook>();
+        auto book2 = std::make_unique<DeepBook>();
+        for (int i = 0; i < 600; ++i) {
+            const int p = (i * 7) % 600;
+            CHECK(book1->insert<side::ask>(Level{100 + 2 * p, i}) == book2->insert<side::ask>(Level{100 + 2 * p, i}));
+        }
+        for (int p = 98; p < 1302; p += 3) {
+            CHECK(book1->lower_bound<side::ask>(p) == book2->lower_bound<side::ask>(p));
+            CHECK(book1->upper_bound<side::ask>(p) == book2->upper_bound<side::ask>(p));
+            CHECK(book1->binary_search<side::ask>(p) == book2->binary_search<side::ask>(p));
+        }
+    }
+}
+
+namespace {
+    // Records calls to top_changed() hook
+    struct TopPolicy : Level {
+        inline static int changes[2] = {};
+        inline static int last = -1;
+
+        template <market::side Side, typename Book>
+        static void top_changed(const Book& book) {
+            ++changes[(size_t)Side];
+            const auto* top = book.template top<Side>();
+            last = top == nullptr ? -1 : top->ticks;
+        }
+    };
+
+    struct TopBook : market::book<Level, TopPolicy> {
+        TopBook() : book(data, 0, 0) {
+            TopPolicy::changes[0] = TopPolicy::changes[1] = 0;
+            reset();
+        }
+
+        book::data<5> data;
+        using book::reset;
+    };
+}
+
+TEST_CASE("TopBook_top", "[book][top][generation][insert][push_back][remove][sort][reset][apply_batch]") {
+    using namespace market;
+    using action = market::action;
+    TopBook book;
+    const auto& changes = TopPolicy::changes;
+    REQUIRE(book.top<side::bid>() == nullptr);
+    REQUIRE(book.top<side::ask>() == nullptr);
+    REQUIRE(book.generation() == 0);
+
+    SECTION("insert and remove") {
+        book.insert<side::bid>(Level{100, 1});
+        REQUIRE(book.top<side::bid>() != nullptr);
+        CHECK(*book.top<side::bid>() == Level{100, 1});
+        CHECK(book.generation() == 1);
+        CHECK(changes[0] == 1);
+        CHECK(TopPolicy::last == 100);
+
+        // Deeper levels do not change the top
+        book.insert<side::bid>(Level{99, 2});
+        book.emplace<side::bid>(98, 3);
+        book.remove<side::bid>(2);
+        CHECK(book.generation() == 1);
+        CHECK(changes[0] == 1);
+
+        book.emplace<side::bid>(101, 4);
+        CHECK(*book.top<side::bid>() == Level{101, 4});
+        CHECK(&book.at<side::bid>(0) == book.top<side::bid>());
+        CHECK(book.generation() == 2);
+        CHECK(TopPolicy::last == 101);
+
+        book.insert<side::ask>(Level{102, 5});
+        CHECK(book.generation() == 3);
+        CHECK(changes[1] == 1);
+        CHECK(TopPolicy::last == 102);
+
+        book.remove<side::bid>(0);
+        CHECK(*book.top<side::bid>() == Level{100, 1});
+        CHECK(book.generation() == 4);
+        CHECK(changes[0] == 3);
+
+        book.remove<side::ask>(0);
+        CHECK(book.top<side::ask>() == nullptr);
+        CHECK(book.generation() == 5);
+        CHECK(changes[1] == 2);
+        CHECK(TopPolicy::last == -1);
+
+        // Changing contents of the top level is not tracked
+        book.at<side::bid>(0).size = 10;
+        CHECK(book.top<side::bid>()->size == 10);
+        CHECK(book.generation() == 5);
+    }
+
+    SECTION("push_back and sort") {
+        book.push_back<side::ask>(Level{103, 1});
+        book.push_back<side::ask>(Level{101, 2});
+        book.emplace_back<side::ask>(102, 3);
+        CHECK(book.generation() == 1);
+        CHECK(*book.top<side::ask>() == Level{103, 1});
+        book.sort<side::ask>();
+        CHECK(book.generation() == 2);
+        CHECK(*book.top<side::ask>() == Level{101, 2});
+        book.sort<side::ask>();
+        CHECK(book.generation() == 2);
+        CHECK(changes[1] == 2);
+    }
+
+    SECTION("apply_batch reusing the slot of the top level") {
+        book.insert<side::bid>(Level{10, 1});
+        REQUIRE(book.generation() == 1);
+        BatchOp ops[] = {
+            {action::erase, Level{10, 0}},
+            {action::insert, Level{12, 2}},
+        };
+        CHECK(book.apply_batch<side::bid>(std::span<BatchOp>(ops)) == 2);
+        CHECK(*book.top<side::bid>() == Level{12, 2});
+        CHECK(book.generation() == 2);
+        CHECK(changes[0] == 2);
+        CHECK(TopPolicy::last == 12);
+
+        // Update of the top level in a batch is tracked too, unlike at()
+        BatchOp update[] = {{action::update, Level{12, 3}}};
+        CHECK(book.apply_batch<side::bid>(std::span<BatchOp>(update)) == 1);
+        CHECK(book.generation() == 3);
+        CHECK(changes[0] == 3);
+
+        // Batch below the top level does not change it
+        BatchOp deeper[] = {{action::insert, Level{11, 4}}};
+        CHECK(book.apply_batch<side::bid>(std::span<BatchOp>(deeper)) == 1);
+        CHECK(book.generation() == 3);
+    }
+
+    SECTION("reset") {
+        book.insert<side::bid>(Level{100, 1});
+        book.insert<side::ask>(Level{101, 1});
+        CHECK(book.generation() == 2);
+        book.reset();
+        CHECK(book.top<side::bid>() == nullptr);
+        CHECK(book.top<side::ask>() == nullptr);
+        CHECK(book.generation() == 4);
+        CHECK(changes[0] == 2);
+        CHECK(changes[1] == 2);
+        book.reset();
+        CHECK(book.generation() == 4);
+    }
+}
+
 namespace {
     struct ConstLevel {
         const int ticks; // Regular assignment won't work here
@@ -1079,6 +2101,16 @@ TEST_CASE("SmallConstBook_immutable", "[book][emplace_back][remove][sort][size][
             CHECK(book.binary_search<side::ask>(120131) == SmallBook::npos);
         }
 
+        SECTION("emplace() works on immutable data") {
+            book.remove<side::ask>(1);
+            book.remove<side::ask>(0);
+            CHECK(book.emplace<side::ask>(120120) == 0);
+            CHECK(book.emplace<side::ask>(120118) == 0);
+            CHECK(book.emplace<side::ask>(120114) == SmallConstBook::npos);
+            CHECK(book.at<side::ask>(0) == ConstLevel{120118});
+            CHECK(book.at<side::ask>(1) == ConstLevel{120120});
+        }
+
         auto& level = book.at<side::ask>(0);
         static_assert(std::is_same_v<decltype(level.ticks), const int>);
     }
@@ -1198,6 +2230,8 @@ TEST_CASE("OneLevel_constexpr", "[book][capacity][size][full][empty][at][constex
         CHECK(book.at<side::ask>(0) == ConstLevel{130125});
         CHECK(book.binary_search<side::bid>(130120) == 0);
         CHECK(book.binary_search<side::ask>(130125) == 0);
+        static_assert(OneLevel{}.top<side::ask>()->ticks == 130125);
+        CHECK(book.top<side::bid>() == &book.at<side::bid>(0));
     }
 }
 
@@ -1227,5 +2261,73 @@ TEST_CASE("OneSided_constexpr", "[book][capacity][size][full][empty][at][constex
         REQUIRE(not book.full<side::ask>());
         CHECK(book.binary_search<side::bid>(130120) == 0);
         CHECK(book.binary_search<side::ask>(130125) == OneSided::npos);
+        static_assert(OneSided{}.top<side::ask>() == nullptr);
+    }
+}
+
+namespace {
+    using StaticBook = market::static_book<Level, 4>;
+
+    // Reference book built during compilation
+    constexpr StaticBook reference() {
+        StaticBook book;
+        book.insert<market::side::bid>(Level{130120, 1});
+        book.insert<market::side::bid>(Level{130140, 2});
+        book.emplace<market::side::bid>(130130, 3);
+        book.push_back<market::side::ask>(Level{130170, 4});
+        book.push_back<market::side::ask>(Level{130150, 5});
+        book.sort<market::side::ask>();
+        book.remove<market::side::bid>(2);
+        return book;
+    }
+}
+
+TEST_CASE("StaticBook_constexpr", "[book][static_book][capacity][insert][emplace][remove][sort][constexpr]") {
+    using namespace market;
+    static_assert(StaticBook::capacity == 4);
+    static_assert(std::is_same_v<StaticBook::size_type, uint8_t>);
+    static_assert(std::is_same_v<static_book<Level, 200>::size_type, uint16_t>);
+    static_assert(reference().size<side::bid>() == 2);
+    static_assert(reference().at<side::bid>(0).ticks == 130140);
+    static_assert(reference().at<side::bid>(1).ticks == 130130);
+    static_assert(reference().top<side::ask>()->ticks == 130150);
+    static_assert(reference().binary_search<side::ask>(130170) == 1);
+    static_assert(reference().lower_bound<side::bid>(130135) == 1);
+    static_assert(reference().find<side::bid>(Level{130120, 0}) == StaticBook::npos);
+    static_assert([] {
+        auto book = reference();
+        for (int i = 0; i < 4; ++i) {
+            book.insert<side::ask>(Level{130180 + i, i});
+        }
+        return book.full<side::ask>() && book.size<side::ask>() == 4;
+    }());
+
+    SECTION("same as book with runtime capacity") {
+        StaticBook book1;
+        AnySizeBook book2{4};
+        for (int i : {130130, 130110, 130150, 130120, 130140, 130100}) {
+            CHECK(book1.insert<side::bid>(Level{i, i}) == book2.insert<side::bid>(Level{i, i}));
+            CHECK(book1.insert<side::ask>(Level{i, i}) == book2.insert<side::ask>(Level{i, i}));
+        }
+        check_same_search<side::bid>(book1, book2, 130090, 130160);
+        check_same_search<side::ask>(book1, book2, 130090, 130160);
+        book1.remove<side::ask>(1);
+        book2.remove<side::ask>(1);
+        check_same_search<side::ask>(book1, book2, 130090, 130160);
+    }
+
+    SECTION("copy owns its levels") {
+        auto book1 = reference();
+        StaticBook book2;
+        book2 = book1;
+        book1.at<side::bid>(0).size = 10;
+        book1.remove<side::ask>(0);
+        CHECK(book2.at<side::bid>(0) == Level{130140, 2});
+        REQUIRE(book2.size<side::ask>() == 2);
+        CHECK(*book2.top<side::ask>() == Level{130150, 5});
+        CHECK(book2.insert<side::bid>(Level{130150, 6}) == 0);
+        CHECK(book2.insert<side::bid>(Level{130110, 7}) == 3);
+        CHECK(book2.full<side::bid>());
+        CHECK(book1.size<side::bid>() == 2);
     }
 }
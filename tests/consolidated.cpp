@@ -0,0 +1,135 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "assert.hpp"
+
+#include "market/consolidated.hpp"
+#include "level.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <array>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+    using tests::Level;
+
+    struct Book : market::book<Level> {
+        Book() : book<Level>(data, 0, 0) {
+            reset();
+        }
+
+        using book::reset;
+
+        book::data<10> data;
+    };
+
+    using Entry = std::pair<Level, std::uint64_t>;
+
+    template <market::side Side, typename View>
+    std::vector<Entry> merged(const View& view, std::size_t m) {
+        std::vector<Entry> result;
+        const auto n = view.template for_each<Side>(m, [&](const Level& l, std::uint64_t venues) {
+            result.emplace_back(l, venues);
+        });
+        CHECK(n == result.size());
+        return result;
+    }
+
+    // Materialized merge of all venues, for comparison
+    template <market::side Side, std::size_t N>
+    std::vector<Entry> expected(const std::array<Book, N>& books, std::size_t m) {
+        std::map<int, Entry> levels;
+        for (std::size_t v = 0; v < N; ++v) {
+            for (int i = 0; i < (int)books[v].template size<Side>(); ++i) {
+                const auto& l = books[v].template at<Side>(i);
+                auto& e = levels.try_emplace(Side == market::side::bid ? -l.ticks : l.ticks, Level{l.ticks, 0}, 0)
+                        .first->second;
+                e.first.size += l.size;
+                e.second |= 1ull << v;
+            }
+        }
+        std::vector<Entry> result;
+        for (const auto& [k, e] : levels) {
+            if (result.size() == m) {
+                break;
+            }
+            result.push_back(e);
+        }
+        return result;
+    }
+}
+
+TEST_CASE("Consolidated_basics", "[consolidated][for_each][best][top][refresh][update]") {
+    using namespace market;
+    std::array<Book, 3> books;
+    consolidated<Book, 3> view({&books[0], &books[1], &books[2]});
+    CHECK(view.best<side::bid>() == view.npos);
+    CHECK(view.top<side::ask>() == nullptr);
+    CHECK(merged<side::bid>(view, 5).empty());
+
+    books[0].insert<side::bid>(Level{100, 1});
+    books[0].insert<side::bid>(Level{98, 2});
+    books[1].insert<side::bid>(Level{99, 3});
+    books[1].insert<side::bid>(Level{98, 4});
+    books[2].insert<side::bid>(Level{100, 5});
+    books[2].insert<side::ask>(Level{101, 6});
+    CHECK(view.refresh() == 3);
+    CHECK(view.refresh() == 0);
+    CHECK(view.best<side::bid>() == 0); // Lower venue wins a tie
+    CHECK(*view.top<side::bid>() == Level{100, 1});
+    CHECK(view.best<side::ask>() == 2);
+    CHECK(merged<side::bid>(view, 5) == std::vector<Entry>{{{100, 6}, 5}, {{99, 3}, 2}, {{98, 6}, 3}});
+    CHECK(merged<side::bid>(view, 2) == std::vector<Entry>{{{100, 6}, 5}, {{99, 3}, 2}});
+    CHECK(merged<side::ask>(view, 5) == std::vector<Entry>{{{101, 6}, 4}});
+
+    SECTION("incremental update of one venue") {
+        books[1].insert<side::bid>(Level{102, 7});
+        CHECK(view.refresh() == 1);
+        CHECK(view.best<side::bid>() == 1);
+        CHECK(merged<side::bid>(view, 2) == std::vector<Entry>{{{102, 7}, 2}, {{100, 6}, 5}});
+        books[1].remove<side::bid>(0);
+        books[0].remove<side::bid>(0);
+        CHECK(view.refresh() == 2);
+        CHECK(view.best<side::bid>() == 2);
+    }
+
+    SECTION("explicit update after change of price") {
+        books[2].at<side::bid>(0).ticks = 103;
+        CHECK(view.refresh() == 0);
+        view.update<side::bid>(2);
+        CHECK(view.best<side::bid>() == 2);
+        CHECK(merged<side::bid>(view, 1) == std::vector<Entry>{{{103, 5}, 4}});
+    }
+}
+
+TEST_CASE("Consolidated_random", "[consolidated][for_each][refresh]") {
+    using namespace market;
+    std::array<Book, 5> books;
+    consolidated<Book, 5> view({&books[0], &books[1], &books[2], &books[3], &books[4]});
+    std::mt19937 gen(11);
+    std::uniform_int_distribution<int> price(100, 115);
+    std::uniform_int_distribution<int> venue(0, 4);
+    for (int n = 0; n < 5000; ++n) {
+        auto& b = books[venue(gen)];
+        const int p = price(gen);
+        if (gen() % 3 == 0 && b.size<side::bid>() > 0) {
+            b.remove<side::bid>((uint8_t)(gen() % b.size<side::bid>()));
+        } else if (gen() % 3 == 0 && b.size<side::ask>() > 0) {
+            b.remove<side::ask>((uint8_t)(gen() % b.size<side::ask>()));
+        } else {
+            b.insert<side::bid>(Level{p, n});
+            b.insert<side::ask>(Level{p + 10, n});
+        }
+        view.refresh();
+        for (std::size_t m : {1, 3, 20}) {
+            REQUIRE(merged<side::bid>(view, m) == expected<side::bid>(books, m));
+            REQUIRE(merged<side::ask>(view, m) == expected<side::ask>(books, m));
+        }
+    }
+}
@@ -0,0 +1,156 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "assert.hpp"
+
+#include "market/delta.hpp"
+#include "level.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <iterator>
+#include <random>
+#include <vector>
+
+namespace {
+    using tests::Level;
+    using tests::LinearPolicy;
+    using tests::CumulativePolicy;
+
+    template <typename Policy = Level>
+    struct Book : market::book<Level, Policy> {
+        Book() : market::book<Level, Policy>(data, 0, 0) {
+            this->reset();
+        }
+
+        typename market::book<Level, Policy>::template data<10> data;
+    };
+
+    using op = market::delta::op<Level>;
+
+    template <market::side Side, typename Policy>
+    void check_same(const Book<Policy>& lh, const Book<Policy>& rh) {
+        REQUIRE(lh.template size<Side>() == rh.template size<Side>());
+        for (int i = 0; i < (int)lh.template size<Side>(); ++i) {
+            CHECK(lh.template at<Side>(i) == rh.template at<Side>(i));
+        }
+    }
+
+    // Random changes of both books, with prices from narrow range so there are many updates
+    template <typename Policy>
+    void random_roundtrip() {
+        using namespace market;
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<int> price(100, 115);
+        std::uniform_int_distribution<int> size(1, 3);
+        std::uniform_int_distribution<int> count(0, 10);
+        auto fill = [&](Book<Policy>& b) {
+            for (int i = count(gen); i > 0; --i) {
+                const Level l{price(gen), size(gen)};
+                if (b.template find<side::bid>(l) == b.npos) {
+                    b.template insert<side::bid>(l);
+                }
+            }
+            for (int i = count(gen); i > 0; --i) {
+                const Level l{price(gen), size(gen)};
+                if (b.template find<side::ask>(l) == b.npos) {
+                    b.template insert<side::ask>(l);
+                }
+            }
+        };
+
+        for (int n = 0; n < 200; ++n) {
+            Book<Policy> from, to, copy;
+            fill(from);
+            fill(to);
+            for (int i = 0; i < (int)from.template size<side::bid>(); ++i) {
+                copy.template push_back<side::bid>(from.template at<side::bid>(i));
+            }
+            for (int i = 0; i < (int)from.template size<side::ask>(); ++i) {
+                copy.template push_back<side::ask>(from.template at<side::ask>(i));
+            }
+
+            std::vector<op> ops;
+            delta::diff(from, to, std::back_inserter(ops));
+            CHECK(ops.size() <= (std::size_t)(from.template size<side::bid>() + from.template size<side::ask>()
+                                              + to.template size<side::bid>() + to.template size<side::ask>()));
+            CHECK(delta::apply(copy, ops.begin(), ops.end()) == ops.end());
+            check_same<side::bid>(copy, to);
+            check_same<side::ask>(copy, to);
+
+            ops.clear();
+            delta::diff(copy, to, std::back_inserter(ops));
+            CHECK(ops.empty());
+        }
+    }
+}
+
+TEST_CASE("Delta_diff", "[delta][diff][apply][find]") {
+    using namespace market;
+    using delta::action;
+    constexpr auto bid = (std::uint8_t)side::bid;
+    constexpr auto ask = (std::uint8_t)side::ask;
+    Book<> from, to;
+    from.insert<side::bid>(Level{100, 1});
+    from.insert<side::bid>(Level{99, 2});
+    from.insert<side::bid>(Level{98, 3});
+    from.insert<side::ask>(Level{101, 4});
+    to.insert<side::bid>(Level{101, 5});
+    to.insert<side::bid>(Level{100, 1});
+    to.insert<side::bid>(Level{98, 6});
+    to.insert<side::ask>(Level{102, 7});
+
+    std::vector<op> ops;
+    delta::diff(from, to, std::back_inserter(ops));
+    REQUIRE(ops.size() == 5);
+    CHECK((ops[0].what == action::erase && ops[0].side == bid && ops[0].level == Level{99, 2}));
+    CHECK((ops[1].what == action::update && ops[1].side == bid && ops[1].level == Level{98, 6}));
+    CHECK((ops[2].what == action::insert && ops[2].side == bid && ops[2].level == Level{101, 5}));
+    CHECK((ops[3].what == action::erase && ops[3].side == ask && ops[3].level == Level{101, 4}));
+    CHECK((ops[4].what == action::insert && ops[4].side == ask && ops[4].level == Level{102, 7}));
+
+    SECTION("apply") {
+        CHECK(delta::apply(from, ops.begin(), ops.end()) == ops.end());
+        check_same<side::bid>(from, to);
+        check_same<side::ask>(from, to);
+    }
+
+    SECTION("apply out of sync") {
+        Book<> other;
+        other.insert<side::bid>(Level{100, 1});
+        other.insert<side::bid>(Level{98, 3});
+        CHECK(delta::apply(other, ops.begin(), ops.end()) == ops.begin());
+        CHECK(delta::apply(other, ops.begin() + 1, ops.end()) == ops.begin() + 3);
+        CHECK(other.at<side::bid>(0) == Level{101, 5});
+        CHECK(other.at<side::bid>(2) == Level{98, 6});
+    }
+
+    SECTION("no changes") {
+        ops.clear();
+        delta::diff(to, to, std::back_inserter(ops));
+        CHECK(ops.empty());
+    }
+}
+
+TEST_CASE("Delta_cumulative", "[delta][apply][cumulative]") {
+    using namespace market;
+    Book<CumulativePolicy> b;
+    b.insert<side::bid>(Level{100, 1});
+    b.insert<side::bid>(Level{99, 2});
+    const op ops[] = {
+        {action::update, (std::uint8_t)side::bid, Level{100, 5}},
+        {action::insert, (std::uint8_t)side::bid, Level{98, 3}},
+    };
+    CHECK(delta::apply(b, std::begin(ops), std::end(ops)) == std::end(ops));
+    CHECK(b.depth<side::bid>(1).quantity == 5);
+    CHECK(b.depth<side::bid>(2).quantity == 7);
+    CHECK(b.depth<side::bid>(3).quantity == 10);
+    CHECK(b.depth<side::bid>(3).notional == 500 + 198 + 294);
+}
+
+TEST_CASE("Delta_random", "[delta][diff][apply][linear]") {
+    random_roundtrip<Level>();
+    random_roundtrip<LinearPolicy>();
+}
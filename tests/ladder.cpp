@@ -0,0 +1,196 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "assert.hpp"
+
+#include "market/ladder.hpp"
+#include "market/book.hpp"
+#include "level.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <random>
+
+namespace {
+    using tests::Level;
+
+    using Ladder = market::ladder<Level>;
+
+    struct Book : market::book<Level> {
+        Book() : book<Level>(data, 0, 0) {
+            reset();
+        }
+
+        book::data<127> data;
+    };
+
+    template <market::side Side>
+    void check_same(const Ladder& lh, const Book& rh, int from, int to) {
+        REQUIRE(lh.size<Side>() == rh.size<Side>());
+        for (int i = 0; i < (int)rh.size<Side>(); ++i) {
+            CHECK(lh.at<Side>(i) == rh.at<Side>(i));
+        }
+        for (int p = from; p <= to; ++p) {
+            const auto npos = [](auto i) { return i == Book::npos ? (int)Ladder::npos : (int)i; };
+            CHECK(lh.lower_bound<Side>(p) == npos(rh.lower_bound<Side>(p)));
+            CHECK(lh.upper_bound<Side>(p) == npos(rh.upper_bound<Side>(p)));
+            CHECK(lh.binary_search<Side>(p) == npos(rh.binary_search<Side>(p)));
+            const auto e = rh.equal_range<Side>(p);
+            CHECK(lh.equal_range<Side>(p) == std::make_pair<Ladder::size_type, Ladder::size_type>(npos(e.first), npos(e.second)));
+        }
+    }
+}
+
+TEST_CASE("Ladder_basics", "[ladder][insert][set][erase][get][remove][at][top]") {
+    using namespace market;
+    Ladder ladder;
+    static_assert(Ladder::capacity == 256);
+    REQUIRE(ladder.empty<side::bid>());
+    REQUIRE(ladder.top<side::bid>() == nullptr);
+    REQUIRE(ladder.lower_bound<side::bid>(100) == Ladder::npos);
+    CHECK_THROWS_AS(ladder.at<side::bid>(0), assert_error);
+
+    CHECK(ladder.insert<side::bid>(Level{1000, 1}) == 0);
+    CHECK(ladder.anchor() == 1000 - 128);
+    CHECK(ladder.insert<side::bid>(Level{1002, 2}) == 0);
+    CHECK(ladder.emplace<side::bid>(998, 3) == 2);
+    CHECK(ladder.insert<side::ask>(Level{1003, 4}) == 0);
+    CHECK(ladder.emplace<side::ask>(1010, 5) == 1);
+    CHECK(ladder.size<side::bid>() == 3);
+    CHECK(ladder.size<side::ask>() == 2);
+    CHECK(*ladder.top<side::bid>() == Level{1002, 2});
+    CHECK(*ladder.top<side::ask>() == Level{1003, 4});
+    CHECK(ladder.at<side::bid>(2) == Level{998, 3});
+
+    // Same price replaces the level
+    CHECK(ladder.insert<side::bid>(Level{1000, 6}) == 1);
+    CHECK(ladder.size<side::bid>() == 3);
+    CHECK(ladder.at<side::bid>(1) == Level{1000, 6});
+
+    // Same, without computing the position
+    auto* const l = ladder.set<side::ask>(Level{1005, 8});
+    REQUIRE(l != nullptr);
+    CHECK(l == ladder.get<side::ask>(1005));
+    CHECK(ladder.set<side::ask>(Level{1005, 9}) == l);
+    CHECK(*l == Level{1005, 9});
+    CHECK(ladder.size<side::ask>() == 3);
+    CHECK(ladder.at<side::ask>(1) == Level{1005, 9});
+    CHECK(ladder.set<side::ask>(Level{1000 + 1000, 1}) == nullptr);
+    CHECK(ladder.erase<side::ask>(1005));
+
+    REQUIRE(ladder.get<side::bid>(998) != nullptr);
+    CHECK(ladder.get<side::bid>(998)->size == 3);
+    CHECK(ladder.get<side::bid>(999) == nullptr);
+    CHECK(ladder.get<side::ask>(998) == nullptr);
+    CHECK(ladder.find<side::ask>(Level{1010, 0}) == 1);
+    ladder.get<side::ask>(1010)->size = 7;
+    CHECK(ladder.at<side::ask>(1) == Level{1010, 7});
+
+    CHECK(ladder.erase<side::bid>(1002));
+    CHECK(not ladder.erase<side::bid>(1002));
+    CHECK(*ladder.top<side::bid>() == Level{1000, 6});
+    ladder.remove<side::bid>(1);
+    CHECK(ladder.size<side::bid>() == 1);
+    CHECK(ladder.get<side::bid>(998) == nullptr);
+    CHECK_THROWS_AS(ladder.remove<side::bid>(1), assert_error);
+
+    ladder.reset();
+    CHECK(ladder.empty<side::bid>());
+    CHECK(ladder.empty<side::ask>());
+}
+
+TEST_CASE("Ladder_recentre", "[ladder][insert][anchor]") {
+    using namespace market;
+    Ladder ladder;
+    CHECK(ladder.insert<side::ask>(Level{-50, 1}) == 0);
+    CHECK(ladder.anchor() == -50 - 128);
+    CHECK(ladder.insert<side::bid>(Level{-60, 2}) == 0);
+
+    // Moves the window up, levels are still found
+    CHECK(ladder.insert<side::ask>(Level{100, 3}) == 1);
+    CHECK(ladder.anchor() <= -60);
+    CHECK(ladder.anchor() + 255 >= 100);
+    CHECK(ladder.at<side::ask>(0) == Level{-50, 1});
+    CHECK(ladder.at<side::ask>(1) == Level{100, 3});
+    CHECK(ladder.at<side::bid>(0) == Level{-60, 2});
+
+    // Does not fit in the window
+    CHECK(ladder.insert<side::ask>(Level{-60 + 256, 4}) == Ladder::npos);
+    CHECK(ladder.insert<side::bid>(Level{100 - 256, 4}) == Ladder::npos);
+    CHECK(ladder.size<side::ask>() == 2);
+    CHECK(ladder.insert<side::ask>(Level{-60 + 255, 4}) == 2);
+    CHECK(ladder.anchor() == -60);
+    CHECK(ladder.at<side::ask>(2) == Level{195, 4});
+
+    // Window moves down after the top levels are removed
+    CHECK(ladder.erase<side::ask>(195));
+    CHECK(ladder.erase<side::ask>(100));
+    CHECK(ladder.insert<side::bid>(Level{-250, 5}) == 1);
+    CHECK(ladder.at<side::bid>(0) == Level{-60, 2});
+    CHECK(ladder.at<side::bid>(1) == Level{-250, 5});
+    CHECK(ladder.at<side::ask>(0) == Level{-50, 1});
+    CHECK(ladder.lower_bound<side::ask>(-100) == 0);
+    CHECK(ladder.lower_bound<side::ask>(1000) == Ladder::npos);
+    CHECK(ladder.lower_bound<side::bid>(-1000) == Ladder::npos);
+    CHECK(ladder.lower_bound<side::bid>(1000) == 0);
+}
+
+TEST_CASE("Ladder_same_as_book", "[ladder][book][insert][remove][lower_bound][upper_bound][equal_range][binary_search]") {
+    using namespace market;
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> price(900, 1100);
+    std::uniform_int_distribution<int> action(0, 3);
+    Ladder ladder;
+    Book book;
+    for (int n = 0; n < 2000; ++n) {
+        const Level l{price(gen), n};
+        switch (action(gen)) {
+            case 0: {
+                const auto i = book.find<side::bid>(l);
+                if (i != Book::npos) {
+                    book.at<side::bid>(i) = l;
+                } else if (book.full<side::bid>()) {
+                    break;
+                } else {
+                    book.insert<side::bid>(l);
+                }
+                ladder.insert<side::bid>(l);
+                break;
+            }
+            case 1: {
+                const auto i = book.find<side::ask>(l);
+                if (i != Book::npos) {
+                    book.at<side::ask>(i) = l;
+                } else if (book.full<side::ask>()) {
+                    break;
+                } else {
+                    book.insert<side::ask>(l);
+                }
+                ladder.insert<side::ask>(l);
+                break;
+            }
+            case 2:
+                if (not book.empty<side::bid>()) {
+                    const auto i = (Book::size_type)(n % book.size<side::bid>());
+                    book.remove<side::bid>(i);
+                    ladder.remove<side::bid>(i);
+                }
+                break;
+            default:
+                if (not book.empty<side::ask>()) {
+                    const auto i = (Book::size_type)(n % book.size<side::ask>());
+                    book.remove<side::ask>(i);
+                    ladder.remove<side::ask>(i);
+                }
+                break;
+        }
+        if (n % 97 == 0) {
+            check_same<side::bid>(ladder, book, 895, 1105);
+            check_same<side::ask>(ladder, book, 895, 1105);
+        }
+    }
+    check_same<side::bid>(ladder, book, 895, 1105);
+    check_same<side::ask>(ladder, book, 895, 1105);
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#pragma once
+
+#include "market/market.hpp"
+
+#include <ostream>
+
+namespace tests {
+    // Level used by most of the tests, price in ticks and aggregated size
+    struct Level {
+        int ticks = -1; int size = -1;
+
+        template <market::side Side>
+        constexpr static bool compare(const Level& lh, const Level& rh) noexcept {
+            return Side == market::side::bid ? lh.ticks > rh.ticks : lh.ticks < rh.ticks;
+        }
+
+        template <market::side Side>
+        constexpr static bool compare(const Level& lh, int rh) noexcept {
+            return Side == market::side::bid ? lh.ticks > rh : lh.ticks < rh;
+        }
+
+        template <market::side Side>
+        constexpr static bool compare(int lh, const Level& rh) noexcept {
+            return Side == market::side::bid ? lh > rh.ticks : lh < rh.ticks;
+        }
+
+        constexpr static int make(int i) {
+            return i;
+        }
+
+        // Required by market::ladder and cumulative totals
+        constexpr static int tick(int i) {
+            return i;
+        }
+
+        constexpr static int tick(const Level& l) {
+            return l.ticks;
+        }
+
+        // Required by market::consolidated
+        constexpr static void combine(Level& lh, const Level& rh) {
+            lh.size += rh.size;
+        }
+    };
+
+    inline bool operator==(const Level& lh, const Level& rh) {
+        return lh.ticks == rh.ticks && lh.size == rh.size;
+    }
+
+    inline std::ostream& operator<<(std::ostream& lh, const Level& rh) {
+        return (lh << '{' << rh.ticks << ',' << rh.size << '}');
+    }
+
+    // Same as Level, but selects linear search mode
+    struct LinearPolicy : Level {
+        constexpr static auto search_mode = market::search::linear;
+
+        template <market::side Side>
+        constexpr static int key(int i) noexcept {
+            return Side == market::side::bid ? -i : i;
+        }
+
+        template <market::side Side>
+        constexpr static int key(const Level& l) noexcept {
+            return key<Side>(l.ticks);
+        }
+    };
+
+    // Same as Level, but selects cumulative totals
+    struct CumulativePolicy : Level {
+        constexpr static bool cumulative = true;
+
+        constexpr static int quantity(const Level& l) noexcept {
+            return l.size;
+        }
+    };
+} // namespace tests
@@ -3,6 +3,8 @@
 // Distributed under the MIT License. See accompanying file LICENSE
 // or copy at https://opensource.org/licenses/MIT
 
+#include "assert.hpp"
+
 #include "market/market.hpp"
 
 #include <catch2/catch.hpp>
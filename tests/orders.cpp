@@ -0,0 +1,241 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "assert.hpp"
+
+#include "market/orders.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+    struct Level {
+        int ticks = -1; long quantity = 0;
+
+        template <market::side Side>
+        constexpr static bool compare(const Level& lh, const Level& rh) noexcept {
+            return Side == market::side::bid ? lh.ticks > rh.ticks : lh.ticks < rh.ticks;
+        }
+
+        template <market::side Side>
+        constexpr static bool compare(const Level& lh, int rh) noexcept {
+            return Side == market::side::bid ? lh.ticks > rh : lh.ticks < rh;
+        }
+
+        template <market::side Side>
+        constexpr static bool compare(int lh, const Level& rh) noexcept {
+            return Side == market::side::bid ? lh > rh.ticks : lh < rh.ticks;
+        }
+
+        constexpr static int make(int i) {
+            return i;
+        }
+
+        constexpr static Level open(std::int64_t ticks) {
+            return Level{(int)ticks, 0};
+        }
+
+        constexpr static void adjust(Level& l, std::int64_t quantity) {
+            l.quantity += quantity;
+        }
+    };
+
+    bool operator==(const Level& lh, const Level& rh) {
+        return lh.ticks == rh.ticks && lh.quantity == rh.quantity;
+    }
+
+    std::ostream& operator<<(std::ostream& lh, const Level& rh) {
+        return (lh << '{' << rh.ticks << ',' << rh.quantity << '}');
+    }
+
+    using Orders = market::orders<Level>;
+
+    template <market::side Side>
+    std::vector<std::uint64_t> ids(const Orders& book, int i) {
+        std::vector<std::uint64_t> result;
+        book.for_each<Side>((Orders::size_type)i, [&](const Orders::order& o) { result.push_back(o.id); });
+        return result;
+    }
+}
+
+TEST_CASE("Orders_basics", "[orders][add][cancel][execute][book]") {
+    using namespace market;
+    Orders book{3, 8};
+    REQUIRE(book.size() == 0);
+    REQUIRE(book.capacity() == 8);
+
+    CHECK(book.add<side::bid>(1, 100, 10));
+    CHECK(book.add<side::bid>(2, 101, 20));
+    CHECK(book.add<side::bid>(3, 100, 30));
+    CHECK(book.add<side::ask>(4, 103, 40));
+    CHECK(not book.add<side::ask>(4, 104, 1)); // Duplicate id
+    REQUIRE(book.size() == 4);
+    REQUIRE(book.book().size<side::bid>() == 2);
+    CHECK(book.book().at<side::bid>(0) == Level{101, 20});
+    CHECK(book.book().at<side::bid>(1) == Level{100, 40});
+    CHECK(book.book().at<side::ask>(0) == Level{103, 40});
+    CHECK(ids<side::bid>(book, 1) == std::vector<std::uint64_t>{1, 3});
+    CHECK(book.front<side::bid>(1).id == 1);
+    REQUIRE(book.get(3) != nullptr);
+    CHECK(book.get(3)->quantity == 30);
+    CHECK(book.get(5) == nullptr);
+
+    SECTION("execute keeps priority until order is filled") {
+        CHECK(book.execute(1, 4) == 4);
+        CHECK(book.get(1)->quantity == 6);
+        CHECK(book.book().at<side::bid>(1) == Level{100, 36});
+        CHECK(ids<side::bid>(book, 1) == std::vector<std::uint64_t>{1, 3});
+        CHECK(book.execute(1, 10) == 6);
+        CHECK(book.get(1) == nullptr);
+        CHECK(book.book().at<side::bid>(1) == Level{100, 30});
+        CHECK(ids<side::bid>(book, 1) == std::vector<std::uint64_t>{3});
+        CHECK(book.execute(1, 10) == 0);
+        CHECK(book.size() == 3);
+    }
+
+    SECTION("quantity must be positive") {
+        CHECK(not book.add<side::bid>(5, 100, 0));
+        CHECK(not book.add<side::bid>(5, 99, -1));
+        CHECK(book.get(5) == nullptr);
+        CHECK(book.book().size<side::bid>() == 2);
+        CHECK(book.execute(1, 0) == 0);
+        CHECK(book.execute(1, -5) == 0);
+        CHECK(book.get(1)->quantity == 10);
+        CHECK(book.book().at<side::bid>(1) == Level{100, 40});
+        CHECK(book.size() == 4);
+    }
+
+    SECTION("last order removes its level") {
+        CHECK(book.cancel(2));
+        CHECK(not book.cancel(2));
+        REQUIRE(book.book().size<side::bid>() == 1);
+        CHECK(book.book().at<side::bid>(0) == Level{100, 40});
+        CHECK(book.execute(4, 40) == 40);
+        CHECK(book.book().empty<side::ask>());
+        CHECK(book.size() == 2);
+    }
+
+    SECTION("cancel in the middle of the queue") {
+        CHECK(book.add<side::bid>(5, 100, 50));
+        CHECK(book.cancel(3));
+        CHECK(ids<side::bid>(book, 1) == std::vector<std::uint64_t>{1, 5});
+        CHECK(book.add<side::bid>(3, 100, 1));
+        CHECK(ids<side::bid>(book, 1) == std::vector<std::uint64_t>{1, 5, 3});
+        CHECK(book.book().at<side::bid>(1) == Level{100, 61});
+    }
+
+    SECTION("capacity of levels and orders") {
+        CHECK(book.add<side::bid>(5, 99, 1));
+        CHECK(not book.add<side::bid>(6, 98, 1)); // No space for another level
+        CHECK(book.add<side::bid>(6, 99, 1));
+        CHECK(book.add<side::ask>(7, 104, 1));
+        CHECK(book.add<side::ask>(8, 103, 1));
+        CHECK(not book.add<side::ask>(9, 103, 1)); // No space for another order
+        CHECK(book.cancel(5));
+        CHECK(book.add<side::ask>(9, 103, 1));
+        CHECK(ids<side::ask>(book, 0) == std::vector<std::uint64_t>{4, 8, 9});
+        book.clear();
+        CHECK(book.size() == 0);
+        CHECK(book.book().empty<side::bid>());
+        CHECK(book.get(9) == nullptr);
+        CHECK(book.add<side::ask>(9, 103, 1));
+    }
+}
+
+TEST_CASE("Orders_random", "[orders][add][cancel][execute][book]") {
+    using namespace market;
+    // Reference model: queues of order ids for each price, on both sides
+    using queue = std::deque<std::pair<std::uint64_t, long>>;
+    std::map<int, queue> model[2];
+    std::map<std::uint64_t, std::pair<int, int>> where; // id -> side, price
+
+    Orders book{20, 300};
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int> price(100, 130);
+    std::uniform_int_distribution<int> choice(0, 9);
+    // Ids are spread over a large range, with a common stride, to exercise the hash table
+    std::uniform_int_distribution<std::uint64_t> id(0, 500);
+    for (int n = 0; n < 20000; ++n) {
+        const auto i = id(gen) * 4096 + 17;
+        const auto c = choice(gen);
+        if (c < 5) {
+            const int s = (int)(gen() & 1);
+            const int p = price(gen) + (s == 0 ? 0 : 40);
+            const long q = 1 + (long)(gen() % 100);
+            const bool room = where.size() < 300 && (model[s].count(p) != 0 || model[s].size() < 20);
+            const bool added = s == 0 ? book.add<side::bid>(i, p, q) : book.add<side::ask>(i, p, q);
+            REQUIRE(added == (where.count(i) == 0 && room));
+            if (added) {
+                model[s][p].emplace_back(i, q);
+                where[i] = {s, p};
+            }
+        } else if (c < 7) {
+            REQUIRE(book.cancel(i) == (where.count(i) != 0));
+            if (where.count(i) != 0) {
+                const auto [s, p] = where[i];
+                auto& q = model[s][p];
+                q.erase(std::find_if(q.begin(), q.end(), [&](const auto& o) { return o.first == i; }));
+                if (q.empty()) {
+                    model[s].erase(p);
+                }
+                where.erase(i);
+            }
+        } else {
+            const long e = 1 + (long)(gen() % 60);
+            long expected = 0;
+            if (where.count(i) != 0) {
+                const auto [s, p] = where[i];
+                auto& q = model[s][p];
+                auto it = std::find_if(q.begin(), q.end(), [&](const auto& o) { return o.first == i; });
+                expected = std::min(e, it->second);
+                it->second -= expected;
+                if (it->second == 0) {
+                    q.erase(it);
+                    if (q.empty()) {
+                        model[s].erase(p);
+                    }
+                    where.erase(i);
+                }
+            }
+            REQUIRE(book.execute(i, e) == expected);
+        }
+
+        REQUIRE(book.size() == where.size());
+        if (n % 100 == 0) {
+            auto check = [&]<side Side>(const std::map<int, queue>& m) {
+                REQUIRE(book.book().size<Side>() == m.size());
+                int k = 0;
+                auto verify = [&](int p, const queue& q) {
+                    long total = 0;
+                    std::vector<std::uint64_t> expected;
+                    for (const auto& o : q) {
+                        total += o.second;
+                        expected.push_back(o.first);
+                    }
+                    CHECK(book.book().at<Side>(k) == Level{p, total});
+                    CHECK(ids<Side>(book, k) == expected);
+                    ++k;
+                };
+                if constexpr (Side == side::bid) {
+                    for (auto it = m.rbegin(); it != m.rend(); ++it) {
+                        verify(it->first, it->second);
+                    }
+                } else {
+                    for (const auto& [p, q] : m) {
+                        verify(p, q);
+                    }
+                }
+            };
+            check.template operator()<side::bid>(model[0]);
+            check.template operator()<side::ask>(model[1]);
+        }
+    }
+}
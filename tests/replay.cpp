@@ -0,0 +1,199 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "assert.hpp"
+
+#include "market/replay.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+namespace {
+    std::string temp_path(const char* suffix) {
+        return "/tmp/market-tests-" + std::to_string(::getpid()) + "-" + suffix;
+    }
+
+    // Removes the file on scope exit
+    struct temp_file {
+        const std::string path;
+        ~temp_file() { std::remove(path.c_str()); }
+    };
+
+    using market::replay::event;
+    using market::replay::record;
+
+    record make(std::uint32_t instrument, event type, market::side side, std::int32_t ticks, std::int64_t quantity) {
+        return record{0, instrument, ticks, quantity, type, (std::uint8_t)side, {}};
+    }
+
+    // Simple model of the books, price to quantity on each side
+    struct model {
+        std::map<std::int32_t, std::int64_t, std::greater<>> bid;
+        std::map<std::int32_t, std::int64_t> ask;
+    };
+
+    template <typename Map>
+    void apply(Map& m, const record& r) {
+        switch (r.type) {
+            case event::add: m[r.ticks] = r.quantity; break;
+            case event::modify: m.at(r.ticks) = r.quantity; break;
+            case event::erase: m.erase(r.ticks); break;
+            default: break;
+        }
+    }
+
+    // Same as replay::level, but selects cumulative totals
+    struct cumulative_level : market::replay::level {
+        constexpr static bool cumulative = true;
+
+        constexpr static std::int64_t quantity(const market::replay::level& l) noexcept {
+            return l.quantity;
+        }
+
+        constexpr static std::int32_t tick(const market::replay::level& l) noexcept {
+            return l.ticks;
+        }
+    };
+
+    template <market::side Side, typename Map, typename Book>
+    void check_same(const Map& m, const Book& b) {
+        REQUIRE(m.size() == b.template size<Side>());
+        int i = 0;
+        for (const auto& [ticks, quantity] : m) {
+            CHECK(b.template at<Side>(i).ticks == ticks);
+            CHECK(b.template at<Side>(i).quantity == quantity);
+            ++i;
+        }
+    }
+}
+
+TEST_CASE("Replay_engine", "[replay][engine][apply]") {
+    using namespace market;
+    replay::engine<> engine(3, 2);
+    const record records[] = {
+        make(1, event::add, side::bid, 100, 10),
+        make(1, event::add, side::bid, 101, 11),
+        make(1, event::add, side::bid, 99, 12), // dropped, side full
+        make(1, event::add, side::bid, 100, 13), // same as modify
+        make(1, event::modify, side::ask, 102, 14), // dropped, missing
+        make(2, event::add, side::ask, 102, 15),
+        make(1, event::erase, side::bid, 101, 0),
+        make(1, event::erase, side::bid, 101, 0), // dropped, missing
+        make(2, event::clear, side::bid, 0, 0),
+        make(0, event::add, side::ask, 103, 16),
+        make(7, event::add, side::ask, 103, 17), // dropped, no more books
+        make(0, (event)9, side::ask, 103, 16), // dropped, invalid
+    };
+    const auto s = engine.run(std::begin(records), std::end(records));
+    CHECK(s.events == 12);
+    CHECK(s.dropped == 5);
+    CHECK(s.events_per_sec() > 0.0);
+
+    auto& books = engine.books();
+    REQUIRE(books.used() == 3);
+    REQUIRE(books[1].size<side::bid>() == 1);
+    CHECK(books[1].at<side::bid>(0).ticks == 100);
+    CHECK(books[1].at<side::bid>(0).quantity == 13);
+    CHECK(books[1].empty<side::ask>());
+    CHECK(books[2].empty<side::ask>());
+    CHECK(books[0].at<side::ask>(0).quantity == 16);
+}
+
+TEST_CASE("Replay_cumulative", "[replay][engine][apply][cumulative]") {
+    using namespace market;
+    replay::engine<cumulative_level> engine(1, 4);
+    const record records[] = {
+        make(0, event::add, side::ask, 101, 10),
+        make(0, event::add, side::ask, 102, 20),
+        make(0, event::modify, side::ask, 101, 5),
+        make(0, event::add, side::ask, 102, 30), // same as modify
+    };
+    const auto s = engine.run(std::begin(records), std::end(records));
+    CHECK(s.dropped == 0);
+    const auto& b = engine.books()[0];
+    CHECK(b.depth<side::ask>(1).quantity == 5);
+    CHECK(b.depth<side::ask>(2).quantity == 35);
+    CHECK(b.depth<side::ask>(2).notional == 5 * 101 + 30 * 102);
+}
+
+TEST_CASE("Replay_file", "[replay][file][write][generate]") {
+    using namespace market;
+    const temp_file f{temp_path("replay")};
+
+    SECTION("missing or invalid file") {
+        CHECK_THROWS_AS(replay::file(f.path), std::system_error);
+        std::FILE* const out = std::fopen(f.path.c_str(), "wb");
+        std::fputs("not a replay file, but long enough", out);
+        std::fclose(out);
+        CHECK_THROWS_AS(replay::file(f.path), replay::bad_file);
+    }
+
+    SECTION("instrument id too large") {
+        const record records[] = {
+            make(1, event::add, side::bid, 100, 1),
+            make(0xFFFFFFFF, event::add, side::bid, 100, 1), // dropped
+            make(replay::record::max_instruments, event::add, side::bid, 100, 1), // dropped
+        };
+        CHECK(replay::instruments(std::begin(records), std::end(records)) == 2);
+        replay::write(f.path, std::begin(records), std::end(records));
+        const replay::file file(f.path);
+        REQUIRE(file.size() == 3);
+        replay::engine<> engine(2, 4);
+        engine.prepare(file.begin(), file.end());
+        CHECK(engine.books().used() == 1);
+        const auto s = engine.run(file.begin(), file.end());
+        CHECK(s.events == 3);
+        CHECK(s.dropped == 2);
+    }
+
+    SECTION("generate, write and replay") {
+        const auto records = replay::generate(20000, 5, 42);
+        REQUIRE(records.size() == 20000);
+        replay::write(f.path, records.data(), records.data() + records.size());
+
+        const replay::file file(f.path);
+        REQUIRE(file.size() == records.size());
+        REQUIRE(replay::instruments(file.begin(), file.end()) == 5);
+        CHECK(file.end()[-1].time == records.back().time);
+
+        replay::engine<> engine(5, 64);
+        engine.prepare(file.begin(), file.end());
+        CHECK(engine.books().used() == 5);
+        const auto s = engine.run(file.begin(), file.end());
+        CHECK(s.events == 20000);
+        CHECK(s.dropped == 0);
+
+        std::vector<model> expected(5);
+        for (const auto& r : records) {
+            auto& m = expected[r.instrument];
+            if (r.type == event::clear) {
+                m = model{};
+            } else if (r.side == (std::uint8_t)side::bid) {
+                apply(m.bid, r);
+            } else {
+                apply(m.ask, r);
+            }
+        }
+        for (std::uint32_t i = 0; i < 5; ++i) {
+            check_same<side::bid>(expected[i].bid, engine.books()[i]);
+            check_same<side::ask>(expected[i].ask, engine.books()[i]);
+        }
+
+        // Same input produces the same books
+        replay::engine<> other(5, 64);
+        other.run(records.data(), records.data() + records.size());
+        CHECK(other.checksum() == engine.checksum());
+        other.books().reset();
+        CHECK(other.checksum() != engine.checksum());
+    }
+}
@@ -0,0 +1,183 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "assert.hpp"
+
+#include "market/seqlock.hpp"
+#include "market/book.hpp"
+#include "level.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace {
+    using tests::Level;
+    using tests::CumulativePolicy;
+
+    struct Book : market::book<Level> {
+        Book() : book<Level>(data, 0, 0) {
+            reset();
+        }
+
+        book::data<20> data;
+    };
+
+    using VersionedBook = market::versioned<Book>;
+
+    struct CumulativeBook : market::book<Level, CumulativePolicy> {
+        CumulativeBook() : book<Level, CumulativePolicy>(data, 0, 0) {
+            reset();
+        }
+
+        book::data<4> data;
+    };
+
+    struct BatchOp {
+        market::action what;
+        Level level;
+    };
+}
+
+TEST_CASE("Versioned_basics", "[seqlock][versioned][read][write][apply_batch]") {
+    using namespace market;
+    using action = market::action;
+    VersionedBook book;
+    Level out[8] = {};
+    REQUIRE(book.version() == 0);
+    CHECK(book.read<side::bid>(out, 8) == 0);
+
+    SECTION("every modification increments version by 2") {
+        CHECK(book.push_back<side::bid>(Level{100, 1}) == 0);
+        CHECK(book.version() == 2);
+        CHECK(book.emplace_back<side::bid>(102, 2) == 1);
+        CHECK(book.version() == 4);
+        book.sort<side::bid>();
+        CHECK(book.version() == 6);
+        CHECK(book.insert<side::ask>(Level{105, 3}) == 0);
+        CHECK(book.emplace<side::ask>(104, 4) == 0);
+        CHECK(book.version() == 10);
+        book.remove<side::ask>(1);
+        CHECK(book.version() == 12);
+        CHECK(book.write([](Book& b) { return b.at<side::bid>(0).size = 5; }) == 5);
+        CHECK(book.version() == 14);
+        BatchOp ops[] = {{action::insert, Level{106, 6}}, {action::erase, Level{106, 0}}};
+        CHECK(book.apply_batch<side::ask>(std::span<BatchOp>(ops)) == 1);
+        CHECK(book.version() == 16);
+        CHECK(book.size<side::ask>() == 2);
+        book.remove<side::ask>(1);
+        CHECK(book.version() == 18);
+        CHECK(book.emplace<side::ask>(106, 7) == 1);
+        book.write([](Book& b) { b.at<side::ask>(0).ticks = 108; });
+        CHECK(book.resort_one<side::ask>(0) == 1);
+        CHECK(book.version() == 24);
+        CHECK(book.at<side::ask>(1) == Level{108, 4});
+        book.remove<side::ask>(0);
+        book.write([](Book& b) { b.at<side::ask>(0).ticks = 104; });
+        CHECK(book.version() == 28);
+
+        // Only const iterators are available, levels can be only modified inside write()
+        static_assert(std::is_same_v<decltype(book.begin<side::bid>()), VersionedBook::const_iterator>);
+        static_assert(std::is_same_v<decltype(book.range<side::bid>().end()), VersionedBook::const_iterator>);
+        CHECK(book.end<side::bid>() - book.begin<side::bid>() == 2);
+        CHECK(*book.range<side::ask>().begin() == Level{104, 4});
+
+        CHECK(book.sizes() == std::make_pair<VersionedBook::size_type, VersionedBook::size_type>(2, 1));
+        CHECK(book.at<side::bid>(0) == Level{102, 5});
+        CHECK(book.at<side::ask>(0) == Level{104, 4});
+    }
+
+    SECTION("read() copies top levels") {
+        for (int i = 0; i < 10; ++i) {
+            book.insert<side::ask>(Level{110 - i, i});
+        }
+        CHECK(book.read<side::bid>(out, 8) == 0);
+        REQUIRE(book.read<side::ask>(out, 3) == 3);
+        CHECK(out[0] == Level{101, 9});
+        CHECK(out[1] == Level{102, 8});
+        CHECK(out[2] == Level{103, 7});
+        REQUIRE(book.read<side::ask>(out, 8) == 8);
+        CHECK(out[7] == Level{108, 2});
+        CHECK(book.read<side::ask>(out, 0) == 0);
+    }
+}
+
+TEST_CASE("Versioned_cumulative", "[seqlock][versioned][write][cumulative]") {
+    using namespace market;
+    versioned<CumulativeBook> book;
+    book.insert<side::bid>(Level{100, 1});
+    book.insert<side::bid>(Level{99, 2});
+    CHECK(book.version() == 4);
+    book.write([](CumulativeBook& b) { b.at<side::bid>(0).size = 5; });
+    book.recount<side::bid>(0);
+    CHECK(book.version() == 8);
+    CHECK(book.depth<side::bid>(2).quantity == 7);
+}
+
+TEST_CASE("Versioned_concurrent", "[seqlock][versioned][read][thread]") {
+    using namespace market;
+    VersionedBook book;
+    constexpr int depth = 8;
+    constexpr int updates = 20000;
+
+    // Every update leaves the book in the state where all bid levels have the same size, which is
+    // the number of the update, and ticks in descending order.
+    for (int i = 0; i < depth; ++i) {
+        book.push_back<side::bid>(Level{100 - i, 0});
+    }
+
+    std::atomic<bool> done = false;
+    std::atomic<int> torn = 0;
+    std::atomic<int> reads = 0;
+    auto reader = [&]() {
+        Level out[depth] = {};
+        int last = 0;
+        while (not done.load(std::memory_order_relaxed)) {
+            const auto n = book.read<side::bid>(out, depth);
+            bool ok = n == depth - 1 || n == depth;
+            for (int i = 0; ok && i < (int)n; ++i) {
+                ok = out[i].size == out[0].size && (i == 0 || out[i].ticks < out[i - 1].ticks);
+            }
+            ok = ok && out[0].size >= last;
+            last = out[0].size;
+            torn += (int)!ok;
+            ++reads;
+        }
+    };
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 3; ++i) {
+        readers.emplace_back(reader);
+    }
+    while (reads == 0) {
+        std::this_thread::yield();
+    }
+
+    for (int u = 1; u <= updates; ++u) {
+        const int ticks = book.at<side::bid>(0).ticks;
+        book.remove<side::bid>(0);
+        book.write([u](Book& b) {
+            for (int i = 0; i < (int)b.size<side::bid>(); ++i) {
+                b.at<side::bid>(i).size = u;
+            }
+        });
+        book.insert<side::bid>(Level{ticks, u});
+        if (u % 1000 == 0) {
+            std::this_thread::yield();
+        }
+    }
+    done = true;
+    for (auto& t : readers) {
+        t.join();
+    }
+
+    CHECK(torn == 0);
+    CHECK(reads > 0);
+    CHECK(book.version() == (std::uint64_t)(2 * depth + 6 * updates));
+}
@@ -0,0 +1,141 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "assert.hpp"
+
+#include "market/sharded.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <atomic>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+    using market::replay::event;
+    using market::replay::level;
+    using market::replay::record;
+
+    record make(std::uint32_t instrument, event type, market::side side, std::int32_t ticks, std::int64_t quantity) {
+        return record{0, instrument, ticks, quantity, type, (std::uint8_t)side, {}};
+    }
+
+    // Levels as pairs of ticks and quantity, for comparison
+    using levels_t = std::vector<std::pair<std::int32_t, std::int64_t>>;
+
+    template <market::side Side, typename Book>
+    levels_t levels(const Book& b) {
+        levels_t result;
+        for (int i = 0; i < (int)b.template size<Side>(); ++i) {
+            result.emplace_back(b.template at<Side>(i).ticks, b.template at<Side>(i).quantity);
+        }
+        return result;
+    }
+
+    template <market::side Side, typename Sharded>
+    levels_t read(const Sharded& s, std::uint32_t instrument) {
+        level out[64];
+        levels_t result;
+        const auto n = s.template read<Side>(instrument, out, 64);
+        for (std::size_t i = 0; i < n; ++i) {
+            result.emplace_back(out[i].ticks, out[i].quantity);
+        }
+        return result;
+    }
+}
+
+TEST_CASE("Sharded_basics", "[sharded][post][flush][read][sizes]") {
+    using namespace market;
+    replay::sharded<> books(2, 3, 4);
+    REQUIRE(books.shards() == 2);
+    CHECK(books.shard(0) == 0);
+    CHECK(books.shard(1) == 1);
+    CHECK(books.shard(2) == 0);
+    CHECK(not books.pinned(0));
+
+    books.post(make(2, event::add, side::bid, 100, 10));
+    books.post(make(2, event::add, side::bid, 101, 20));
+    books.post(make(1, event::add, side::ask, 105, 30));
+    books.post(make(1, event::modify, side::ask, 106, 1)); // Dropped, no such level
+    books.post(make(3, event::add, side::ask, 105, 30)); // Dropped, unknown instrument
+    books.flush();
+
+    const auto s = books.stats();
+    CHECK(s.events == 5);
+    CHECK(s.dropped == 2);
+    CHECK(books.sizes(2) == std::make_pair<std::uint8_t, std::uint8_t>(2, 0));
+    CHECK(books.sizes(3) == std::make_pair<std::uint8_t, std::uint8_t>(0, 0));
+    CHECK(read<side::bid>(books, 2) == levels_t{{101, 20}, {100, 10}});
+    CHECK(read<side::ask>(books, 1) == levels_t{{105, 30}});
+    CHECK(read<side::ask>(books, 0).empty());
+    CHECK(read<side::ask>(books, 3).empty());
+    REQUIRE(books.book(1) != nullptr);
+    CHECK(books.book(1)->size<side::ask>() == 1);
+    CHECK(books.book(3) == nullptr);
+
+    level out[1];
+    CHECK(books.read<side::bid>(2, out, 1) == 1);
+    CHECK(out[0].ticks == 101);
+    CHECK(out[0].quantity == 20);
+
+    books.post(make(2, event::clear, side::bid, 0, 0));
+    books.flush();
+    CHECK(books.sizes(2) == std::make_pair<std::uint8_t, std::uint8_t>(0, 0));
+}
+
+TEST_CASE("Sharded_replay", "[sharded][run][engine]") {
+    using namespace market;
+    constexpr std::uint32_t instruments = 37;
+    const auto records = replay::generate(30000, instruments, 5);
+
+    replay::engine<> single(instruments, 64);
+    const auto expected = single.run(records.data(), records.data() + records.size());
+
+    for (std::size_t shards : {1, 3, 4}) {
+        replay::sharded<> books(shards, instruments, 64, 16);
+        const auto s = books.run(records.data(), records.data() + records.size());
+        CHECK(s.events == expected.events);
+        CHECK(s.dropped == expected.dropped);
+        for (std::uint32_t i = 0; i < instruments; ++i) {
+            const auto* const b = single.books().find(i);
+            REQUIRE(b != nullptr);
+            CHECK(read<side::bid>(books, i) == levels<side::bid>(*b));
+            CHECK(read<side::ask>(books, i) == levels<side::ask>(*b));
+        }
+    }
+}
+
+TEST_CASE("Sharded_concurrent", "[sharded][post][read][thread]") {
+    using namespace market;
+    constexpr std::uint32_t instruments = 8;
+    const auto records = replay::generate(100000, instruments, 9);
+    replay::sharded<> books(2, instruments, 64, 64);
+
+    // Every event leaves a book sorted, so a read which is not sorted must have been torn
+    std::atomic<bool> done = false;
+    std::atomic<int> torn = 0;
+    std::atomic<int> reads = 0;
+    std::thread reader([&]() {
+        level out[64];
+        for (std::uint32_t i = 0; not done.load(std::memory_order_relaxed); i = (i + 1) % instruments) {
+            const auto n = books.read<side::bid>(i, out, 64);
+            for (std::size_t j = 1; j < n; ++j) {
+                torn += (int)(out[j].ticks >= out[j - 1].ticks);
+            }
+            ++reads;
+        }
+    });
+    while (reads == 0) {
+        std::this_thread::yield();
+    }
+    books.run(records.data(), records.data() + records.size());
+    done = true;
+    reader.join();
+
+    CHECK(torn == 0);
+    CHECK(reads > 0);
+    CHECK(books.stats().events == records.size());
+}
@@ -0,0 +1,150 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "assert.hpp"
+
+#include "market/shm.hpp"
+#include "level.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <string>
+#include <system_error>
+
+#include <unistd.h>
+
+namespace {
+    using tests::Level;
+    using tests::LinearPolicy;
+
+    std::string unique_name(const char* suffix) {
+        return "/market-tests-" + std::to_string(::getpid()) + "-" + suffix;
+    }
+}
+
+TEST_CASE("Shm_segment", "[shm][segment]") {
+    using namespace market::shm;
+    const auto name = unique_name("segment");
+
+    SECTION("open() missing segment") {
+        CHECK_THROWS_AS(segment::open(name), std::system_error);
+        CHECK(not segment::remove(name));
+    }
+
+    SECTION("create() and open() same segment") {
+        auto w = segment::create(name, 100);
+        CHECK(w.size() == 100);
+        static_cast<char*>(w.data())[99] = 'x';
+        const auto r = segment::open(name);
+        CHECK(r.size() == 100);
+        CHECK(r.data() != w.data());
+        CHECK(static_cast<const char*>(r.data())[99] == 'x');
+        CHECK(segment::remove(name));
+        CHECK_THROWS_AS(segment::open(name), std::system_error);
+        // Mapping is still valid after name was removed
+        CHECK(static_cast<const char*>(r.data())[99] == 'x');
+    }
+
+    SECTION("create() replaces existing segment") {
+        auto w1 = segment::create(name, 100);
+        static_cast<char*>(w1.data())[99] = 'x';
+        const auto r = segment::open(name);
+        auto w2 = segment::create(name, 10);
+        CHECK(segment::open(name).size() == 10);
+        // Existing mappings still refer to the old segment, which was neither truncated nor cleared
+        CHECK(static_cast<const char*>(r.data())[99] == 'x');
+        static_cast<char*>(w1.data())[0] = 'y';
+        CHECK(static_cast<const char*>(r.data())[0] == 'y');
+        CHECK(static_cast<const char*>(w2.data())[0] == 0);
+        CHECK(segment::remove(name));
+    }
+}
+
+TEST_CASE("Shm_books", "[shm][writer][reader][insert][remove]") {
+    using namespace market;
+    using writer_t = shm::writer<Level>;
+    using reader_t = shm::reader<Level>;
+    const auto name = unique_name("books");
+
+    writer_t writer(name, 3, 5);
+    REQUIRE(writer.size() == 3);
+    REQUIRE(writer[0].capacity == 5);
+    const reader_t reader(name);
+    REQUIRE(reader.size() == 3);
+
+    SECTION("empty books") {
+        for (std::size_t i = 0; i < 3; ++i) {
+            const auto view = reader[i];
+            CHECK(view.capacity == 5);
+            CHECK(view.empty<side::bid>());
+            CHECK(view.empty<side::ask>());
+        }
+    }
+
+    SECTION("changes visible after commit()") {
+        auto& book = writer[1];
+        CHECK(book.insert<side::bid>(Level{100, 1}) == 0);
+        CHECK(book.insert<side::bid>(Level{102, 2}) == 0);
+        CHECK(book.insert<side::ask>(Level{103, 3}) == 0);
+        CHECK(reader[1].empty<side::bid>());
+        book.commit();
+
+        const auto view = reader[1];
+        REQUIRE(view.size<side::bid>() == 2);
+        REQUIRE(view.size<side::ask>() == 1);
+        CHECK(view.at<side::bid>(0) == Level{102, 2});
+        CHECK(view.at<side::bid>(1) == Level{100, 1});
+        CHECK(view.at<side::ask>(0) == Level{103, 3});
+        CHECK(view.binary_search<side::bid>(100) == 1);
+        CHECK(reader[0].empty<side::bid>());
+        CHECK(reader[2].empty<side::bid>());
+
+        // No copy, the view refers to levels stored in the segment (mapped at a different address)
+        CHECK(&view.at<side::bid>(1) != &book.at<side::bid>(1));
+        book.at<side::bid>(1).size = 7;
+        CHECK(view.at<side::bid>(1) == Level{100, 7});
+
+        // Contents of levels change in place, sizes only after commit()
+        book.remove<side::bid>(0);
+        book.at<side::bid>(0).size = 10;
+        CHECK(reader[1].size<side::bid>() == 2);
+        writer.commit();
+        CHECK(reader[1].size<side::bid>() == 1);
+        CHECK(reader[1].at<side::bid>(0) == Level{100, 10});
+
+        book.reset();
+        CHECK(reader[1].empty<side::bid>());
+        CHECK(reader[1].empty<side::ask>());
+    }
+
+    SECTION("layout mismatch") {
+        using wide_t = shm::reader<Level, Level, uint16_t>;
+        using linear_t = shm::reader<Level, LinearPolicy>;
+        CHECK_THROWS_AS(wide_t(name), wide_t::bad_layout);
+        CHECK_THROWS_AS(linear_t(name), linear_t::bad_layout);
+        CHECK_NOTHROW(reader_t(name));
+    }
+
+    SECTION("bad capacity") {
+        CHECK_THROWS_AS(writer_t(unique_name("bad"), 1, 128), writer_t::book_type::bad_capacity);
+    }
+}
+
+TEST_CASE("Shm_books_linear", "[shm][writer][reader][linear]") {
+    using namespace market;
+    const auto name = unique_name("linear");
+
+    shm::writer<Level, LinearPolicy, uint16_t> writer(name, 2, 300);
+    const shm::reader<Level, LinearPolicy, uint16_t> reader(name);
+    for (int i = 0; i < 300; ++i) {
+        writer[1].emplace<side::ask>(1000 + (i * 7) % 300, i);
+    }
+    writer[1].commit();
+    const auto view = reader[1];
+    REQUIRE(view.size<side::ask>() == 300);
+    CHECK(view.lower_bound<side::ask>(1100) == 100);
+    CHECK(view.binary_search<side::ask>(1299) == 299);
+    CHECK(view.upper_bound<side::ask>(1299) == view.npos);
+}
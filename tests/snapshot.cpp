@@ -0,0 +1,171 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "assert.hpp"
+
+#include "market/snapshot.hpp"
+#include "level.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstring>
+#include <vector>
+
+namespace {
+    using tests::Level;
+    using tests::LinearPolicy;
+
+    template <typename Policy = Level>
+    struct Book : market::book<Level, Policy> {
+        Book() : market::book<Level, Policy>(data, 0, 0) {
+            this->reset();
+        }
+
+        typename market::book<Level, Policy>::template data<20> data;
+    };
+
+    // Buffer aligned to 8 bytes
+    struct buffer {
+        std::vector<std::uint64_t> storage;
+        explicit buffer(std::size_t size) : storage((size + 7) / 8 + 1) {}
+        void* data() { return storage.data(); }
+        std::size_t size() const { return storage.size() * 8; }
+    };
+}
+
+TEST_CASE("Snapshot_roundtrip", "[snapshot][write][view][size]") {
+    using namespace market;
+    Book<> book;
+
+    SECTION("empty book") {
+        buffer b(snapshot::size(book));
+        CHECK(snapshot::size(book) == sizeof(snapshot::header));
+        CHECK(snapshot::write(book, b.data(), b.size()) == sizeof(snapshot::header));
+        const snapshot::view<Level> view(b.data(), b.size());
+        CHECK(view.capacity == 0);
+        CHECK(view.empty<side::bid>());
+        CHECK(view.empty<side::ask>());
+    }
+
+    SECTION("levels compacted") {
+        for (int i = 0; i < 6; ++i) {
+            book.insert<side::bid>(Level{100 - (i * 5) % 6, i});
+        }
+        book.insert<side::ask>(Level{102, 7});
+        book.insert<side::ask>(Level{101, 8});
+        book.remove<side::bid>(2);
+        // 40 bytes header, 7*8 bytes of levels, 2*5 bytes of sides rounded up to 8 bytes
+        REQUIRE(snapshot::size(book) == 40 + 56 + 16);
+        buffer b(snapshot::size(book));
+        CHECK_THROWS_AS(snapshot::write(book, b.data(), snapshot::size(book) - 1), snapshot::bad_snapshot);
+        REQUIRE(snapshot::write(book, b.data(), b.size()) == snapshot::size(book));
+
+        const snapshot::view<Level> view(b.data(), snapshot::size(book));
+        CHECK(view.capacity == 5);
+        REQUIRE(view.size<side::bid>() == 5);
+        REQUIRE(view.size<side::ask>() == 2);
+        for (int i = 0; i < 5; ++i) {
+            CHECK(view.at<side::bid>(i) == book.at<side::bid>(i));
+        }
+        CHECK(view.at<side::ask>(0) == Level{101, 8});
+        CHECK(view.at<side::ask>(1) == Level{102, 7});
+        CHECK(view.binary_search<side::bid>(97) == 2);
+        CHECK(view.lower_bound<side::ask>(102) == 1);
+        CHECK(view.full<side::bid>());
+
+        // No copy, the view refers to the buffer
+        CHECK((const void*)&view.at<side::bid>(0) > b.data());
+        CHECK((const void*)&view.at<side::bid>(0) < (const char*)b.data() + b.size());
+    }
+}
+
+TEST_CASE("Snapshot_linear", "[snapshot][write][view][linear]") {
+    using namespace market;
+    Book<LinearPolicy> book;
+    for (int i = 0; i < 20; ++i) {
+        book.emplace<side::ask>(1000 + (i * 7) % 20, i);
+        book.emplace<side::bid>(1000 - (i * 3) % 20, i);
+    }
+    buffer b(snapshot::size(book));
+    snapshot::write(book, b.data(), b.size());
+    const snapshot::view<Level, LinearPolicy> view(b.data(), b.size());
+    REQUIRE(view.size<side::ask>() == 20);
+    REQUIRE(view.size<side::bid>() == 20);
+    for (int i = 0; i < 20; ++i) {
+        CHECK(view.binary_search<side::ask>(1000 + i) == i);
+        CHECK(view.binary_search<side::bid>(1000 - i) == i);
+    }
+    CHECK(view.upper_bound<side::ask>(1019) == view.npos);
+    CHECK_THROWS_AS((snapshot::view<Level>(b.data(), b.size())), snapshot::bad_snapshot);
+}
+
+TEST_CASE("Snapshot_static", "[snapshot][write][view][static_book]") {
+    using namespace market;
+    using view_t = snapshot::view<Level, Level, std::uint8_t, 8>;
+    static_book<Level, 8> book;
+    book.insert<side::bid>(Level{100, 1});
+    book.insert<side::bid>(Level{99, 2});
+    book.insert<side::ask>(Level{101, 3});
+    const auto size = snapshot::size(book);
+    CHECK(size == snapshot::layout<Level, Level, std::uint8_t, 8>::from(2, 1).bytes);
+    buffer b(size);
+    CHECK(snapshot::write(book, b.data(), b.size()) == size);
+    CHECK(static_cast<const snapshot::header*>(b.data())->capacity == 8);
+
+    const view_t view(b.data(), size);
+    REQUIRE(view.size<side::bid>() == 2);
+    REQUIRE(view.size<side::ask>() == 1);
+    CHECK(view.at<side::bid>(0) == Level{100, 1});
+    CHECK(view.at<side::bid>(1) == Level{99, 2});
+    CHECK(view.at<side::ask>(0) == Level{101, 3});
+    CHECK(view.top<side::ask>() == &view.at<side::ask>(0));
+    CHECK(view.binary_search<side::bid>(99) == 1);
+
+    // Capacity of the snapshot must match
+    CHECK_THROWS_AS(snapshot::view<Level>(b.data(), size), snapshot::bad_snapshot);
+    CHECK_THROWS_AS((snapshot::view<Level, Level, std::uint8_t, 4>(b.data(), size)), snapshot::bad_snapshot);
+}
+
+TEST_CASE("Snapshot_validate", "[snapshot][view]") {
+    using namespace market;
+    using wide_t = snapshot::view<Level, Level, uint16_t>;
+    Book<> book;
+    book.insert<side::bid>(Level{100, 1});
+    book.insert<side::bid>(Level{99, 2});
+    const auto size = snapshot::size(book);
+    buffer b(size);
+    snapshot::write(book, b.data(), b.size());
+    CHECK_NOTHROW(snapshot::view<Level>(b.data(), size));
+
+    SECTION("truncated") {
+        CHECK_THROWS_AS(snapshot::view<Level>(b.data(), size - 1), snapshot::bad_snapshot);
+        CHECK_THROWS_AS(snapshot::view<Level>(b.data(), 10), snapshot::bad_snapshot);
+    }
+
+    SECTION("misaligned") {
+        buffer c(size + 8);
+        std::memcpy((char*)c.data() + 4, b.data(), size);
+        CHECK_THROWS_AS(snapshot::view<Level>((char*)c.data() + 4, size), snapshot::bad_snapshot);
+    }
+
+    SECTION("wrong type of book") {
+        CHECK_THROWS_AS(wide_t(b.data(), size), snapshot::bad_snapshot);
+    }
+
+    SECTION("corrupted") {
+        auto* const h = static_cast<snapshot::header*>(b.data());
+        SECTION("magic") {
+            h->magic ^= 1;
+        }
+        SECTION("size") {
+            h->size[1] = 1;
+        }
+        SECTION("index") {
+            auto* const sides = (std::uint8_t*)b.data() + snapshot::layout<Level>::from(2, 0).sides;
+            sides[1] = 2;
+        }
+        CHECK_THROWS_AS(snapshot::view<Level>(b.data(), size), snapshot::bad_snapshot);
+    }
+}
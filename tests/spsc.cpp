@@ -0,0 +1,69 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "assert.hpp"
+
+#include "market/spsc.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+TEST_CASE("Spsc_basics", "[spsc][try_push][try_pop][consume]") {
+    using namespace market;
+    CHECK_THROWS_AS(spsc<int>(0), std::length_error);
+    spsc<int> ring(5);
+    REQUIRE(ring.capacity() == 8);
+    CHECK(ring.empty());
+    int v = -1;
+    CHECK(not ring.try_pop(v));
+
+    for (int i = 0; i < 8; ++i) {
+        CHECK(ring.try_push(i));
+    }
+    CHECK(not ring.try_push(8)); // Full
+    CHECK(ring.size() == 8);
+    REQUIRE(ring.try_pop(v));
+    CHECK(v == 0);
+    CHECK(ring.try_push(8)); // Wraps around
+
+    std::vector<int> out;
+    CHECK(ring.consume([&](int i) { out.push_back(i); }, 3) == 3);
+    CHECK(out == std::vector<int>{1, 2, 3});
+    CHECK(ring.consume([&](int i) { out.push_back(i); }, 100) == 5);
+    CHECK(out == std::vector<int>{1, 2, 3, 4, 5, 6, 7, 8});
+    CHECK(ring.consume([&](int i) { out.push_back(i); }, 100) == 0);
+    CHECK(ring.empty());
+}
+
+TEST_CASE("Spsc_concurrent", "[spsc][try_push][consume][thread]") {
+    using namespace market;
+    spsc<std::uint64_t> ring(64);
+    constexpr std::uint64_t count = 200000;
+
+    std::uint64_t expected = 0;
+    bool ordered = true;
+    std::thread consumer([&]() {
+        while (expected < count) {
+            ring.consume([&](std::uint64_t v) {
+                ordered = ordered && v == expected;
+                ++expected;
+            }, 16);
+        }
+    });
+    for (std::uint64_t i = 0; i < count; ++i) {
+        while (not ring.try_push(i)) {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+
+    CHECK(ordered);
+    CHECK(expected == count);
+    CHECK(ring.empty());
+}
@@ -0,0 +1,141 @@
+// Copyright (c) 2018 Bronislaw (Bronek) Kozicki
+//
+// Distributed under the MIT License. See accompanying file LICENSE
+// or copy at https://opensource.org/licenses/MIT
+
+#include "assert.hpp"
+
+#include "market/book.hpp"
+#include "market/stats.hpp"
+#include "level.hpp"
+
+#include <catch2/catch.hpp>
+
+#include <sstream>
+#include <string>
+
+namespace {
+    using tests::Level;
+
+    struct Instrumented : Level {
+        constexpr static bool instrumented = true;
+    };
+
+    // Only provides the hook, which counts all events in a static array
+    struct Hooked : Level {
+        inline static market::counters seen = {};
+
+        template <market::metric Metric, typename Book>
+        static void note(const Book& , std::uint64_t n) {
+            seen.add(Metric, n);
+        }
+    };
+
+    template <typename Policy>
+    struct Book : market::book<Level, Policy> {
+        Book() : market::book<Level, Policy>(data, 0, 0) {
+            this->reset();
+        }
+
+        typename market::book<Level, Policy>::template data<4> data;
+    };
+}
+
+TEST_CASE("Stats_book", "[stats][book][instrumented][note]") {
+    using namespace market;
+    static_assert(Book<Instrumented>::instrumented && not Book<Level>::instrumented);
+    static_assert(sizeof(market::book<Level>) == sizeof(market::book<Level, Hooked>));
+    static_assert(sizeof(market::book<Level>) < sizeof(market::book<Level, Instrumented>));
+
+    Book<Instrumented> book;
+    const auto& c = book.stats();
+    CHECK(c[metric::pop] == 0);
+    CHECK(book.push_back<side::bid>(Level{104, 1}) == 0);
+    CHECK(book.push_back<side::bid>(Level{100, 1}) == 1);
+    CHECK(c[metric::pop] == 2);
+    CHECK(c[metric::compare] == 0);
+    CHECK(c[metric::shift] == 0);
+
+    CHECK(book.insert<side::bid>(Level{102, 1}) == 1);
+    CHECK(c[metric::pop] == 3);
+    CHECK(c[metric::compare] > 0);
+    CHECK(c[metric::shift] == 1); // One index of one byte
+    CHECK(book.insert<side::bid>(Level{103, 1}) == 1);
+    CHECK(book.insert<side::bid>(Level{101, 1}) == Book<Instrumented>::npos);
+    CHECK(book.push_back<side::bid>(Level{99, 1}) == Book<Instrumented>::npos);
+    CHECK(c[metric::reject] == 2);
+
+    book.remove<side::bid>(0);
+    CHECK(c[metric::push] == 1);
+    CHECK(c[metric::shift] == 1 + 2 + 3);
+
+    book.clear_stats();
+    CHECK(book.binary_search<side::bid>(102) == 1);
+    CHECK(book.lower_bound<side::bid>(101) == 2);
+    CHECK(book.find<side::bid>(Level{100, 0}) == 2);
+    CHECK(c[metric::search] == 3);
+    CHECK(c[metric::compare] > 0);
+    CHECK(c[metric::compare] <= 3 * 4);
+    book.sort<side::bid>();
+    CHECK(c[metric::sort] == 1);
+    CHECK(c[metric::pop] == 0);
+
+    SECTION("hook of the Policy") {
+        Hooked::seen = {};
+        Book<Hooked> other;
+        other.push_back<side::ask>(Level{100, 1});
+        other.insert<side::ask>(Level{99, 1});
+        other.remove<side::ask>(1);
+        CHECK(Hooked::seen[metric::pop] == 2);
+        CHECK(Hooked::seen[metric::push] == 1);
+        CHECK(Hooked::seen[metric::compare] > 0);
+    }
+}
+
+TEST_CASE("Stats_static_book", "[stats][static_book][instrumented]") {
+    using namespace market;
+    static_book<Level, 4, Instrumented> book;
+    book.push_back<side::bid>(Level{104, 1});
+    book.insert<side::bid>(Level{102, 1});
+    REQUIRE(book.stats()[metric::pop] == 2);
+
+    // Copies carry the counters of the source
+    auto copy = book;
+    CHECK(copy.stats()[metric::pop] == 2);
+    CHECK(copy.stats()[metric::compare] == book.stats()[metric::compare]);
+    static_book<Level, 4, Instrumented> other;
+    other = book;
+    CHECK(other.stats()[metric::pop] == 2);
+}
+
+TEST_CASE("Stats_dump", "[stats][dump][total]") {
+    using namespace market;
+    Book<Instrumented> book1, book2;
+    book1.push_back<side::bid>(Level{100, 1});
+    book2.push_back<side::ask>(Level{100, 1});
+    book2.push_back<side::ask>(Level{101, 1});
+    book2.sort<side::ask>();
+
+    stats s;
+    s.add("first", book1);
+    s.add("second", book2);
+    CHECK(s.size() == 2);
+    CHECK(s.total()[metric::pop] == 3);
+    CHECK(s.total()[metric::sort] == 1);
+    CHECK(std::string(name(metric::reject)) == "reject");
+
+    std::ostringstream out;
+    s.dump(out);
+    const auto text = out.str();
+    CHECK(text.find("book ") == 0);
+    CHECK(text.find("compare") != std::string::npos);
+    CHECK(text.find("\nfirst ") != std::string::npos);
+    CHECK(text.find("\nsecond ") != std::string::npos);
+    CHECK(text.find("\ntotal ") != std::string::npos);
+
+    // Counters are read when printed
+    book1.push_back<side::bid>(Level{99, 1});
+    CHECK(s.total()[metric::pop] == 4);
+    s.clear();
+    CHECK(s.size() == 0);
+}
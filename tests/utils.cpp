@@ -3,10 +3,15 @@
 // Distributed under the MIT License. See accompanying file LICENSE
 // or copy at https://opensource.org/licenses/MIT
 
+#include "assert.hpp"
+
 #include "common/utils.hpp"
 
 #include <catch2/catch.hpp>
 
+#include <cstdint>
+#include <cstring>
+
 namespace {
     struct Dummy {
         const int i;
@@ -98,3 +103,58 @@ TEST_CASE("Emplace", "[emplace]") {
     // tmp3[0] after it has been replaced by Dummy, living at the very same memory location
     // CHECK(tmp3[0] == 8); LEAVE IT OUT EVEN THOUGH IT "WORKS" !
 }
+
+namespace {
+    template <typename Type>
+    constexpr bool shift_constexpr() {
+        Type a[5] = {1, 2, 3, 4, 5};
+        common::shift(a, a + 1, 4);
+        common::shift(a + 1, a, 3);
+        return a[0] == 2 && a[1] == 2 && a[2] == 3 && a[3] == 4 && a[4] == 5;
+    }
+
+    template <typename Type>
+    void shift_check(std::size_t n, std::size_t from, std::size_t to) {
+        Type expected[300] = {};
+        Type actual[300] = {};
+        for (std::size_t i = 0; i < 300; ++i) {
+            expected[i] = actual[i] = (Type)(i * 7 + 1);
+        }
+        std::memmove(expected + to, expected + from, n * sizeof(Type));
+        common::shift(actual + to, actual + from, n);
+        for (std::size_t i = 0; i < 300; ++i) {
+            if (expected[i] != actual[i]) {
+                FAIL("n=" << n << " from=" << from << " to=" << to << " i=" << i);
+            }
+        }
+    }
+}
+
+TEST_CASE("Shift", "[shift]") {
+    static_assert(shift_constexpr<std::uint8_t>());
+    static_assert(shift_constexpr<std::uint16_t>());
+
+    SECTION("shift left by one element, as in removal") {
+        for (std::size_t n = 0; n < 260; ++n) {
+            shift_check<std::uint8_t>(n, 2, 1);
+            shift_check<std::uint16_t>(n, 2, 1);
+        }
+    }
+
+    SECTION("shift right by one element, as in insertion") {
+        for (std::size_t n = 0; n < 260; ++n) {
+            shift_check<std::uint8_t>(n, 1, 2);
+            shift_check<std::uint16_t>(n, 1, 2);
+        }
+    }
+
+    SECTION("shift by more elements, overlapping or not") {
+        for (std::size_t n = 0; n < 140; ++n) {
+            for (std::size_t d : {3, 17, 33, 70, 150}) {
+                shift_check<std::uint8_t>(n, 0, d);
+                shift_check<std::uint8_t>(n, d, 0);
+            }
+        }
+    }
+    SUCCEED();
+}